@@ -0,0 +1,312 @@
+#pragma once
+
+/**
+ * The subset of Arduino core API used by the firmware implemented on top of
+ * the simulated clock (see Simulation.hpp).
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+typedef bool boolean;
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int32_t int32;
+
+#define HEX 16
+#define DEC 10
+
+#define D1 5
+#define D2 4
+#define D5 14
+#define D6 12
+#define D7 13
+
+#define INPUT 0x00
+#define INPUT_PULLUP 0x02
+#define OUTPUT 0x01
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define IRAM_ATTR
+#define digitalPinToInterrupt(pin) (pin)
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define memcpy_P memcpy
+#define strncpy_P strncpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define snprintf_P snprintf
+#define vsnprintf_P vsnprintf
+
+class __FlashStringHelper;
+
+uint32_t
+millis();
+
+uint32_t
+micros();
+
+void
+delay(uint32_t ms);
+
+void
+delayMicroseconds(uint32_t us);
+
+void
+yield();
+
+/* The host clock is synced already, so SNTP is not started (gettimeofday() returns the host time) */
+void
+configTime(int timezone, int daylightOffset, const char* server1, const char* server2 = nullptr,
+           const char* server3 = nullptr);
+
+long
+random(long howbig);
+
+long
+random(long howsmall, long howbig);
+
+void
+randomSeed(unsigned long seed);
+
+void
+pinMode(uint8_t pin, uint8_t mode);
+
+/* The handler is called by the simulation when the device drives the pin (see sim::interrupt) */
+void
+attachInterrupt(uint8_t pin, void (*handler)(), int mode);
+
+void
+detachInterrupt(uint8_t pin);
+
+class Print;
+
+class Printable {
+public:
+    virtual ~Printable() = default;
+
+    virtual size_t
+    printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+    virtual ~Print() = default;
+
+    virtual size_t
+    write(uint8_t c) = 0;
+
+    virtual size_t
+    write(const uint8_t* buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--) {
+            n += write(*buffer++);
+        }
+        return n;
+    }
+
+    size_t
+    write(const char* str)
+    {
+        return (str == nullptr) ? 0 : write(reinterpret_cast<const uint8_t*>(str), strlen(str));
+    }
+
+    size_t
+    write(const char* buffer, size_t size)
+    {
+        return write(reinterpret_cast<const uint8_t*>(buffer), size);
+    }
+
+    virtual int
+    availableForWrite()
+    {
+        return 0;
+    }
+
+    virtual void
+    flush()
+    {
+    }
+
+    size_t
+    printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t
+    print(const __FlashStringHelper* str)
+    {
+        return write(reinterpret_cast<const char*>(str));
+    }
+
+    size_t
+    print(const char* str)
+    {
+        return write(str);
+    }
+
+    size_t
+    print(char c)
+    {
+        return write(static_cast<uint8_t>(c));
+    }
+
+    size_t
+    print(int value, int base = DEC)
+    {
+        return print(static_cast<long>(value), base);
+    }
+
+    size_t
+    print(unsigned value, int base = DEC)
+    {
+        return print(static_cast<unsigned long>(value), base);
+    }
+
+    size_t
+    print(long value, int base = DEC);
+
+    size_t
+    print(unsigned long value, int base = DEC);
+
+    size_t
+    print(double value, int digits = 2);
+
+    size_t
+    print(const Printable& printable)
+    {
+        return printable.printTo(*this);
+    }
+
+    size_t
+    println()
+    {
+        return write("\r\n");
+    }
+
+    template<typename T>
+    size_t
+    println(const T& value)
+    {
+        const size_t n = print(value);
+        return n + println();
+    }
+
+    template<typename T>
+    size_t
+    println(const T& value, int format)
+    {
+        const size_t n = print(value, format);
+        return n + println();
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int
+    available()
+    {
+        return 0;
+    }
+
+    virtual int
+    read()
+    {
+        return -1;
+    }
+
+    void
+    setTimeout(unsigned long timeout)
+    {
+        _timeout = timeout;
+    }
+
+    unsigned long
+    getTimeout() const
+    {
+        return _timeout;
+    }
+
+protected:
+    unsigned long _timeout{1000};
+};
+
+/**
+ * The serial port prints to stderr when the simulation is verbose. The transmit FIFO drains
+ * at the baud rate and the write waits for room in it as the one of the device does.
+ */
+class HardwareSerial : public Stream {
+public:
+    void
+    begin(unsigned long baud)
+    {
+        _baud = baud;
+    }
+
+    size_t
+    write(uint8_t c) override;
+
+    using Print::write;
+
+    int
+    availableForWrite() override;
+
+    explicit operator bool() const
+    {
+        return true;
+    }
+
+private:
+    unsigned long _baud{0};
+    /* The time the FIFO is drained at (fractional milliseconds) */
+    double _idle{0.};
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t
+    getChipId();
+
+    uint32_t
+    getFreeHeap();
+
+    uint32_t
+    getMaxFreeBlockSize();
+
+    uint8_t
+    getHeapFragmentation();
+
+    uint32_t
+    getFreeContStack();
+
+    uint32_t
+    getCycleCount();
+
+    uint8_t
+    getCpuFreqMHz()
+    {
+        return 80;
+    }
+
+    bool
+    rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size);
+
+    bool
+    rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size);
+};
+
+extern EspClass ESP;
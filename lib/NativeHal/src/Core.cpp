@@ -0,0 +1,336 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#include <Wire.h>
+#include <coredecls.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <random>
+
+#include "Simulation.hpp"
+
+HardwareSerial Serial;
+EspClass ESP;
+ESP8266WiFiClass WiFi;
+TwoWire Wire;
+EEPROMClass EEPROM;
+FS LittleFS;
+
+namespace {
+
+std::mt19937&
+generator()
+{
+    static std::mt19937 instance{sim::options().seed};
+    return instance;
+}
+
+/* The RTC user memory survives resets only, so it starts zeroed */
+uint32_t RtcMemory[128]{};
+
+/* The durations of all-channel scan, joining the access point and getting DHCP lease */
+constexpr uint32_t kScanMs = 2000;
+constexpr uint32_t kJoinMs = 300;
+constexpr uint32_t kDhcpMs = 1000;
+
+/* The size of the UART transmit FIFO */
+constexpr int kUartFifo = 128;
+
+/* The interrupt handlers attached to GPIO pins */
+void (*Handlers[17])(){};
+
+} // namespace
+
+uint32_t
+millis()
+{
+    /* Wraps around as 32-bit counter on the device does */
+    return static_cast<uint32_t>(sim::now());
+}
+
+uint32_t
+micros()
+{
+    return static_cast<uint32_t>(sim::now() * 1000);
+}
+
+void
+delay(uint32_t ms)
+{
+    sim::advance(ms);
+}
+
+void
+delayMicroseconds(uint32_t us)
+{
+}
+
+void
+yield()
+{
+}
+
+void
+configTime(int timezone, int daylightOffset, const char* server1, const char* server2, const char* server3)
+{
+}
+
+long
+random(long howbig)
+{
+    return (howbig <= 0) ? 0 : static_cast<long>(generator()() % howbig);
+}
+
+long
+random(long howsmall, long howbig)
+{
+    return (howsmall >= howbig) ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+double
+sim::noise(double deviation)
+{
+    std::normal_distribution<double> distribution{0., deviation};
+    return distribution(generator());
+}
+
+void
+randomSeed(unsigned long seed)
+{
+    generator().seed(seed);
+}
+
+void
+pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void
+attachInterrupt(uint8_t pin, void (*handler)(), int mode)
+{
+    if (pin < std::size(Handlers)) {
+        Handlers[pin] = handler;
+    }
+}
+
+void
+detachInterrupt(uint8_t pin)
+{
+    if (pin < std::size(Handlers)) {
+        Handlers[pin] = nullptr;
+    }
+}
+
+void
+sim::interrupt(uint8_t pin)
+{
+    if (pin < std::size(Handlers) && Handlers[pin] != nullptr) {
+        Handlers[pin]();
+    }
+}
+
+size_t
+Print::printf(const char* format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return (length > 0) ? write(buffer, std::min<size_t>(length, sizeof(buffer) - 1)) : 0;
+}
+
+size_t
+Print::print(long value, int base)
+{
+    if (base == DEC) {
+        return printf("%ld", value);
+    }
+    return print(static_cast<unsigned long>(value), base);
+}
+
+size_t
+Print::print(unsigned long value, int base)
+{
+    switch (base) {
+    case HEX:
+        return printf("%lX", value);
+    case 8:
+        return printf("%lo", value);
+    default:
+        return printf("%lu", value);
+    }
+}
+
+size_t
+Print::print(double value, int digits)
+{
+    return printf("%.*f", digits, value);
+}
+
+int
+HardwareSerial::availableForWrite()
+{
+    if (_baud == 0) {
+        return kUartFifo;
+    }
+    const double pending = std::max(_idle - static_cast<double>(sim::now()), 0.) * _baud / 10000.;
+    return kUartFifo - std::min(static_cast<int>(ceil(pending)), kUartFifo);
+}
+
+size_t
+HardwareSerial::write(uint8_t c)
+{
+    if (sim::options().verbose) {
+        fputc(c, stderr);
+    }
+    if (_baud == 0) {
+        return 1;
+    }
+    /* The byte takes 10 bits (start, 8 data, stop) */
+    const double byteMs = 10000. / _baud;
+    if (availableForWrite() == 0) {
+        /* Wait till the FIFO has room for one more byte */
+        const double room = _idle - (kUartFifo - 1) * byteMs;
+        const auto wait = static_cast<uint32_t>(ceil(room - static_cast<double>(sim::now())));
+        sim::stats().serialStalledMs += wait;
+        sim::advance(wait);
+    }
+    _idle = std::max(_idle, static_cast<double>(sim::now())) + byteMs;
+    return 1;
+}
+
+wl_status_t
+ESP8266WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t* bssid, bool connect)
+{
+    const auto attempt = ++_attempt;
+    _status = WL_DISCONNECTED;
+    /* The access point is not found where it was cached */
+    const bool direct = (channel != 0 && bssid != nullptr);
+    if (direct && (channel != this->channel() || memcmp(bssid, _bssid, sizeof(_bssid)) != 0)) {
+        _status = WL_NO_SSID_AVAIL;
+        return _status;
+    }
+    const uint32_t delay = (direct ? kJoinMs : kScanMs + kJoinMs) + (_static ? 0 : kDhcpMs);
+    sim::schedule(sim::now() + delay, [this, attempt] {
+        if (attempt == _attempt) {
+            _status = WL_CONNECTED;
+        }
+    });
+    return _status;
+}
+
+int32_t
+ESP8266WiFiClass::channel()
+{
+    return sim::options().apChannel;
+}
+
+uint32_t
+EspClass::getChipId()
+{
+    return sim::options().chipId;
+}
+
+uint32_t
+EspClass::getFreeHeap()
+{
+    return 40 * 1024;
+}
+
+uint32_t
+EspClass::getMaxFreeBlockSize()
+{
+    return 32 * 1024;
+}
+
+uint8_t
+EspClass::getHeapFragmentation()
+{
+    return 0;
+}
+
+uint32_t
+EspClass::getFreeContStack()
+{
+    return 2 * 1024;
+}
+
+uint32_t
+EspClass::getCycleCount()
+{
+    /* The host time scaled to 80 MHz clock of the device */
+    const auto elapsed = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() * 80 / 1000);
+}
+
+bool
+EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size)
+{
+    if (offset * 4 + size > sizeof(RtcMemory) || size == 0) {
+        return false;
+    }
+    memcpy(data, &RtcMemory[offset], size);
+    return true;
+}
+
+bool
+EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size)
+{
+    if (offset * 4 + size > sizeof(RtcMemory) || size == 0) {
+        return false;
+    }
+    memcpy(&RtcMemory[offset], data, size);
+    return true;
+}
+
+void
+sim::restoreRtc(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file != nullptr) {
+        if (fread(RtcMemory, sizeof(RtcMemory), 1, file) != 1) {
+            memset(RtcMemory, 0, sizeof(RtcMemory));
+        }
+        fclose(file);
+    }
+}
+
+void
+sim::persistRtc(const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (file != nullptr) {
+        fwrite(RtcMemory, sizeof(RtcMemory), 1, file);
+        fclose(file);
+    }
+}
+
+uint32_t
+crc32(const void* data, size_t length, uint32_t crc)
+{
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (length--) {
+        crc ^= *bytes++;
+        for (int i = 0; i < 8; ++i) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return crc;
+}
+
+void
+esp_schedule()
+{
+}
+
+void
+esp_delay(uint32_t timeout, const std::function<bool()>& blocked)
+{
+    sim::sleep(timeout, blocked);
+}
@@ -0,0 +1,507 @@
+#include <PubSubClient.h>
+#include <SparkFunCCS811.h>
+#include <bsec.h>
+
+#include <chrono>
+#include <thread>
+
+#include "Simulation.hpp"
+
+namespace {
+
+constexpr double kDay = 24. * 60 * 60 * 1000;
+constexpr double kPi = 3.14159265358979323846;
+
+/* The pin nINT of CCS811 is wired to, the same as on the device */
+#if defined(AIROCAT_CCS811_INT) && AIROCAT_CCS811_INT >= 0
+constexpr int kCcs811IntPin = AIROCAT_CCS811_INT;
+#else
+constexpr int kCcs811IntPin = -1;
+#endif
+
+/* The daily wave with the peak at given hour */
+double
+daily(double peakHour)
+{
+    const double hours = static_cast<double>(sim::now()) / kDay * 24.;
+    return std::cos(2. * kPi * (hours - peakHour) / 24.);
+}
+
+/* The room occupancy (0..1): busy in working hours with the peak after noon */
+double
+occupancy()
+{
+    return std::max(0., daily(14.)) * std::max(0., daily(14.));
+}
+
+/* The sudden rise (0..1) in the middle of each spike period decaying within ~30 minutes */
+double
+spike()
+{
+    const auto period = sim::options().spikePeriodMs;
+    if (period == 0) {
+        return 0.;
+    }
+    const auto phase = sim::now() % period;
+    if (phase < period / 2) {
+        return 0.;
+    }
+    return std::exp(-static_cast<double>(phase - period / 2) / (10. * 60 * 1000));
+}
+
+/* The MQTT 3.1.1 control packet headers */
+constexpr uint8_t kConnect = 0x10;
+constexpr uint8_t kConnectAck = 0x20;
+constexpr uint8_t kPublish = 0x30;
+constexpr uint8_t kSubscribe = 0x82;
+constexpr uint8_t kPingRequest = 0xC0;
+constexpr uint8_t kDisconnect = 0xE0;
+
+/* The keep alive interval of PubSubClient and the timeout of waiting for CONNACK */
+constexpr uint32_t kKeepAliveMs = 15 * 1000;
+constexpr uint32_t kConnectTimeoutSec = 2;
+
+void
+appendShort(std::string& body, uint16_t value)
+{
+    body.push_back(static_cast<char>(value >> 8));
+    body.push_back(static_cast<char>(value & 0xFF));
+}
+
+void
+appendString(std::string& body, const std::string& value)
+{
+    appendShort(body, static_cast<uint16_t>(value.size()));
+    body += value;
+}
+
+/* The size of MQTT PUBLISH packet (QoS 0) with given topic and payload */
+size_t
+frameSize(size_t topicLength, size_t payloadLength)
+{
+    size_t remaining = 2 + topicLength + payloadLength;
+    size_t header = 1;
+    do {
+        header++;
+        remaining >>= 7;
+    } while (remaining > 0);
+    return header + 2 + topicLength + payloadLength;
+}
+
+} // namespace
+
+void
+Bsec::begin(uint8_t address, TwoWire& wire)
+{
+    nextCall = 0;
+}
+
+void
+Bsec::begin(bme68x_intf intf,
+            bme68x_read_fptr_t read,
+            bme68x_write_fptr_t write,
+            bme68x_delay_us_fptr_t idleTask,
+            void* intfPtr)
+{
+    _read = read;
+    _write = write;
+    _intfPtr = intfPtr;
+    nextCall = 0;
+}
+
+void
+Bsec::setConfig(const uint8_t* config)
+{
+}
+
+void
+Bsec::setState(uint8_t* state)
+{
+    memcpy(_state, state, sizeof(_state));
+}
+
+void
+Bsec::getState(uint8_t* state)
+{
+    memcpy(state, _state, sizeof(_state));
+}
+
+void
+Bsec::updateSubscription(bsec_virtual_sensor_t* sensors, uint8_t count, float sampleRate)
+{
+    _period = static_cast<uint32_t>(1000.f / sampleRate + 0.5f);
+}
+
+bool
+Bsec::run()
+{
+    const auto now = static_cast<int64_t>(sim::now());
+    if (now < nextCall) {
+        return false;
+    }
+    /* The call later than half of the period misses the sample slot, BSEC warns and goes on */
+    bsecStatus = (nextCall > 0 && now - nextCall > _period / 2) ? BSEC_W_SC_CALL_TIMING_VIOLATION : BSEC_OK;
+    if (sim::replaying()) {
+        return replay();
+    }
+    nextCall = now + _period;
+
+    /* The forced mode measurement: trigger it and read the field data */
+    if (_write != nullptr && _read != nullptr) {
+        const uint8_t mode = 0x25;
+        uint8_t field[15];
+        _write(0x74, &mode, 1, _intfPtr);
+        _read(0x1D, field, sizeof(field), _intfPtr);
+    }
+
+    const double minutes = static_cast<double>(now) / 60000.;
+    stabStatus = (minutes >= 5.) ? 1.f : 0.f;
+    runInStatus = (minutes >= 30.) ? 1.f : 0.f;
+    iaqAccuracy = (minutes >= 30.) ? 3 : (minutes >= 5.) ? 1 : 0;
+
+    rawTemperature = static_cast<float>(22. + 1.5 * daily(16.) + sim::noise(0.02));
+    rawHumidity = static_cast<float>(45. - 5. * daily(16.) + sim::noise(0.05));
+    temperature = rawTemperature - 0.5f;
+    humidity = rawHumidity + 1.5f;
+    pressure = static_cast<float>(101325. + 150. * daily(4.) + sim::noise(2.));
+    iaq = static_cast<float>(40. + 120. * occupancy() + 150. * spike() + sim::noise(0.5));
+    staticIaq = iaq;
+    co2Equivalent = static_cast<float>(500. + 4. * iaq + sim::noise(1.));
+    breathVocEquivalent = static_cast<float>(0.5 + iaq / 100. + sim::noise(0.005));
+    gasResistance = static_cast<float>(150000. - 500. * iaq + sim::noise(300.));
+    gasPercentage = static_cast<float>(std::min(100., iaq / 5.));
+    return true;
+}
+
+bool
+Bsec::replay()
+{
+    trace::Sample sample;
+    const bool taken = sim::replayTake(trace::Source::Bme680, sample);
+    const auto next = sim::replayNext(trace::Source::Bme680);
+    nextCall = (next == UINT64_MAX) ? INT64_MAX : static_cast<int64_t>(next);
+    if (!taken) {
+        return false;
+    }
+    rawTemperature = sample.fields[trace::RawTemperature];
+    rawHumidity = sample.fields[trace::RawHumidity];
+    pressure = sample.fields[trace::Pressure];
+    gasResistance = sample.fields[trace::GasResistance];
+    temperature = sample.fields[trace::Temperature];
+    humidity = sample.fields[trace::Humidity];
+    iaq = sample.fields[trace::Iaq];
+    staticIaq = iaq;
+    co2Equivalent = sample.fields[trace::Co2Equivalent];
+    breathVocEquivalent = sample.fields[trace::BreathVocEquivalent];
+    gasPercentage = sample.fields[trace::GasPercentage];
+    stabStatus = sample.fields[trace::StabStatus];
+    runInStatus = sample.fields[trace::RunInStatus];
+    return true;
+}
+
+int64_t
+Bsec::getTimeMs()
+{
+    return static_cast<int64_t>(sim::now());
+}
+
+bool
+CCS811::begin()
+{
+    _nextData = sim::replaying() ? static_cast<uint32_t>(sim::replayNext(trace::Source::Ccs811)) : millis() + 1000;
+    return true;
+}
+
+bool
+CCS811::dataAvailable()
+{
+    if (sim::replaying()) {
+        return (sim::replayNext(trace::Source::Ccs811) <= sim::now());
+    }
+    return (static_cast<int32_t>(millis() - _nextData) >= 0);
+}
+
+CCS811::CCS811_Status_e
+CCS811::enableInterrupts()
+{
+    _interrupts = true;
+    raise();
+    return CCS811_Stat_SUCCESS;
+}
+
+CCS811::CCS811_Status_e
+CCS811::readAlgorithmResults()
+{
+    if (sim::replaying()) {
+        trace::Sample sample;
+        if (sim::replayTake(trace::Source::Ccs811, sample)) {
+            _co2 = static_cast<uint16_t>(sample.fields[trace::Co2]);
+            _tvoc = static_cast<uint16_t>(sample.fields[trace::Tvoc]);
+        }
+        /* The interrupt stops with the end of trace */
+        const auto next = sim::replayNext(trace::Source::Ccs811);
+        if (next != UINT64_MAX) {
+            _nextData = static_cast<uint32_t>(next);
+            raise();
+        }
+        return CCS811_Stat_SUCCESS;
+    }
+    _nextData = millis() + 1000;
+    raise();
+    _co2 = static_cast<uint16_t>(420. + 900. * occupancy() + 1500. * spike() + sim::noise(8.));
+    _tvoc = static_cast<uint16_t>(std::max(0., (_co2 - 400.) / 4. + sim::noise(2.)));
+    return CCS811_Stat_SUCCESS;
+}
+
+void
+CCS811::raise()
+{
+    /* The falling edge on nINT once the next data is ready */
+    if (_interrupts && kCcs811IntPin >= 0) {
+        const auto remaining = static_cast<int32_t>(_nextData - millis());
+        sim::schedule(sim::now() + std::max(0, remaining), [] { sim::interrupt(kCcs811IntPin); });
+    }
+}
+
+CCS811::CCS811_Status_e
+CCS811::setEnvironmentalData(float humidity, float temperature)
+{
+    return CCS811_Stat_SUCCESS;
+}
+
+bool
+PubSubClient::connect(const char* id, const char* user, const char* pass)
+{
+    _connected = sim::brokerAvailable();
+    if (!_connected) {
+        /* The TCP connect to the unreachable broker blocks until the client timeout */
+        sim::advance(static_cast<uint32_t>(_client.getTimeout()));
+    }
+    if (_connected && sim::options().broker != nullptr) {
+        _connected = connectBroker(id, user, pass);
+    }
+    _state = _connected ? MQTT_CONNECTED : MQTT_CONNECTION_TIMEOUT;
+    if (_connected) {
+        if (sim::stats().connects++ == 0) {
+            sim::stats().firstConnectMs = sim::now();
+        }
+    }
+    return _connected;
+}
+
+void
+PubSubClient::disconnect()
+{
+    if (_connected && sim::options().broker != nullptr) {
+        send(kDisconnect, {});
+        _client.stop();
+    }
+    _connected = false;
+    _state = MQTT_DISCONNECTED;
+}
+
+bool
+PubSubClient::connected()
+{
+    if (_connected && !sim::brokerAvailable()) {
+        _client.stop();
+        _connected = false;
+        _state = MQTT_CONNECTION_LOST;
+    }
+    if (_connected && sim::options().broker != nullptr && !_client.connected()) {
+        _connected = false;
+        _state = MQTT_CONNECTION_LOST;
+    }
+    return _connected;
+}
+
+bool
+PubSubClient::loop()
+{
+    if (!connected() || sim::options().broker == nullptr) {
+        return connected();
+    }
+    receive();
+    if (millis() - _lastOut >= kKeepAliveMs) {
+        send(kPingRequest, {});
+    }
+    return connected();
+}
+
+bool
+PubSubClient::subscribe(const char* topic, uint8_t qos)
+{
+    if (!connected()) {
+        return false;
+    }
+    if (sim::options().broker == nullptr) {
+        return true;
+    }
+    std::string body;
+    appendShort(body, ++_packetId);
+    appendString(body, topic);
+    body.push_back(static_cast<char>(qos));
+    return send(kSubscribe, body);
+}
+
+bool
+PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained)
+{
+    if (!beginPublish(topic, length, retained)) {
+        return false;
+    }
+    write(payload, length);
+    return (endPublish() == 1);
+}
+
+bool
+PubSubClient::beginPublish(const char* topic, unsigned int length, bool retained)
+{
+    if (!connected()) {
+        sim::stats().failures++;
+        return false;
+    }
+    _topic = topic;
+    _payload.clear();
+    _length = length;
+    _retained = retained;
+    return true;
+}
+
+size_t
+PubSubClient::write(uint8_t c)
+{
+    _payload.push_back(static_cast<char>(c));
+    return 1;
+}
+
+size_t
+PubSubClient::write(const uint8_t* buffer, size_t size)
+{
+    _payload.append(reinterpret_cast<const char*>(buffer), size);
+    return size;
+}
+
+int
+PubSubClient::endPublish()
+{
+    if (!connected() || _payload.size() != _length) {
+        sim::stats().failures++;
+        return 0;
+    }
+    if (sim::options().broker != nullptr) {
+        std::string body;
+        appendString(body, _topic);
+        body += _payload;
+        if (!send(kPublish | (_retained ? 1 : 0), body)) {
+            sim::stats().failures++;
+            return 0;
+        }
+    }
+    const auto frame = frameSize(_topic.size(), _payload.size());
+    sim::uplinkSend(frame);
+    sim::record(_topic, reinterpret_cast<const uint8_t*>(_payload.data()), _payload.size(), frame);
+    return 1;
+}
+
+bool
+PubSubClient::connectBroker(const char* id, const char* user, const char* pass)
+{
+    if (!_client.connect(sim::options().broker, sim::options().brokerPort)) {
+        return false;
+    }
+    std::string body;
+    appendString(body, "MQTT");
+    body.push_back(4);
+    body.push_back(static_cast<char>(0x02 | (user != nullptr ? 0x80 : 0) | (pass != nullptr ? 0x40 : 0)));
+    appendShort(body, kKeepAliveMs / 1000);
+    appendString(body, id);
+    if (user != nullptr) {
+        appendString(body, user);
+    }
+    if (pass != nullptr) {
+        appendString(body, pass);
+    }
+    _received.clear();
+    if (!send(kConnect, body)) {
+        return false;
+    }
+
+    /* The CONNACK: [0x20, 2, flags, return code] */
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(kConnectTimeoutSec);
+    while (_received.size() < 4 && std::chrono::steady_clock::now() < deadline) {
+        uint8_t buffer[4];
+        const auto n = _client.read(buffer, sizeof(buffer) - _received.size());
+        if (n > 0) {
+            _received.append(reinterpret_cast<const char*>(buffer), n);
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    const bool accepted = (_received.size() == 4 && static_cast<uint8_t>(_received[0]) == kConnectAck
+                           && _received[3] == 0);
+    _received.clear();
+    if (!accepted) {
+        _client.stop();
+    }
+    return accepted;
+}
+
+bool
+PubSubClient::send(uint8_t header, const std::string& body)
+{
+    std::string packet(1, static_cast<char>(header));
+    size_t remaining = body.size();
+    do {
+        const uint8_t digit = (remaining & 0x7F) | (remaining > 0x7F ? 0x80 : 0);
+        packet.push_back(static_cast<char>(digit));
+        remaining >>= 7;
+    } while (remaining > 0);
+    packet += body;
+    _lastOut = millis();
+    return (_client.write(reinterpret_cast<const uint8_t*>(packet.data()), packet.size()) == packet.size());
+}
+
+void
+PubSubClient::receive()
+{
+    uint8_t buffer[512];
+    int n;
+    while ((n = _client.read(buffer, sizeof(buffer))) > 0) {
+        _received.append(reinterpret_cast<const char*>(buffer), n);
+    }
+
+    while (_received.size() >= 2) {
+        /* The fixed header: type and flags, remaining length of up to 4 bytes */
+        size_t length{0};
+        size_t offset{1};
+        uint8_t digit;
+        do {
+            if (offset == _received.size()) {
+                return;
+            }
+            digit = static_cast<uint8_t>(_received[offset]);
+            length |= static_cast<size_t>(digit & 0x7F) << (7 * (offset - 1));
+            offset++;
+        } while ((digit & 0x80) != 0 && offset < 5);
+        if (_received.size() < offset + length) {
+            return;
+        }
+
+        const auto header = static_cast<uint8_t>(_received[0]);
+        if ((header & 0xF0) == kPublish && length >= 2) {
+            const auto* body = reinterpret_cast<const uint8_t*>(_received.data() + offset);
+            const size_t topicLength = (body[0] << 8) | body[1];
+            /* The packet identifier follows the topic for QoS above 0 */
+            const size_t skip = 2 + topicLength + (((header >> 1) & 3) > 0 ? 2 : 0);
+            if (skip <= length && _callback) {
+                std::string topic(reinterpret_cast<const char*>(body + 2), topicLength);
+                std::string payload(reinterpret_cast<const char*>(body + skip), length - skip);
+                _callback(topic.data(),
+                          reinterpret_cast<uint8_t*>(payload.data()),
+                          static_cast<unsigned int>(payload.size()));
+            }
+        }
+        _received.erase(0, offset + length);
+    }
+}
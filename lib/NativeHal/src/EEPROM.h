@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+class EEPROMClass {
+public:
+    void
+    begin(size_t size)
+    {
+        _data.resize(size, 0xFF);
+    }
+
+    uint8_t
+    read(int address)
+    {
+        return (static_cast<size_t>(address) < _data.size()) ? _data[address] : 0xFF;
+    }
+
+    void
+    write(int address, uint8_t value)
+    {
+        if (static_cast<size_t>(address) < _data.size()) {
+            _data[address] = value;
+        }
+    }
+
+    bool
+    commit()
+    {
+        return true;
+    }
+
+private:
+    std::vector<uint8_t> _data;
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,263 @@
+#pragma once
+
+/**
+ * The simulated WiFi station which associates after the time the scan and DHCP take. The clients accepted by WiFiServer
+ * are backed by host sockets, so the servers of the firmware are reachable from the host.
+ */
+
+#include <Arduino.h>
+#include <Client.h>
+
+#include <memory>
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+} WiFiMode_t;
+
+typedef enum {
+    WIFI_NONE_SLEEP = 0,
+    WIFI_LIGHT_SLEEP = 1,
+    WIFI_MODEM_SLEEP = 2,
+} WiFiSleepType_t;
+
+class IPAddress : public Printable {
+public:
+    IPAddress() = default;
+
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _address{static_cast<uint32_t>(a | b << 8 | c << 16 | d << 24)}
+    {
+    }
+
+    explicit IPAddress(uint32_t address)
+        : _address{address}
+    {
+    }
+
+    operator uint32_t() const
+    {
+        return _address;
+    }
+
+    bool
+    isSet() const
+    {
+        return (_address != 0);
+    }
+
+    size_t
+    printTo(Print& p) const override
+    {
+        return p.printf("%u.%u.%u.%u",
+                        _address & 0xFF,
+                        (_address >> 8) & 0xFF,
+                        (_address >> 16) & 0xFF,
+                        (_address >> 24) & 0xFF);
+    }
+
+private:
+    uint32_t _address{0};
+};
+
+class ESP8266WiFiClass {
+public:
+    bool
+    mode(WiFiMode_t mode)
+    {
+        return true;
+    }
+
+    /* Associates after the scan (unless the channel and BSSID are given) and DHCP (unless configured) */
+    wl_status_t
+    begin(const char* ssid,
+          const char* passphrase = nullptr,
+          int32_t channel = 0,
+          const uint8_t* bssid = nullptr,
+          bool connect = true);
+
+    bool
+    config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = {}, IPAddress dns2 = {})
+    {
+        _static = local.isSet();
+        return true;
+    }
+
+    bool
+    disconnect(bool wifiOff = false)
+    {
+        _attempt++;
+        _status = WL_DISCONNECTED;
+        return true;
+    }
+
+    void
+    persistent(bool persistent)
+    {
+    }
+
+    bool
+    setAutoReconnect(bool autoReconnect)
+    {
+        return true;
+    }
+
+    bool
+    setSleepMode(WiFiSleepType_t type, uint8_t listenInterval = 0)
+    {
+        return true;
+    }
+
+    wl_status_t
+    status()
+    {
+        return _status;
+    }
+
+    IPAddress
+    localIP()
+    {
+        return {192, 168, 1, 100};
+    }
+
+    IPAddress
+    gatewayIP()
+    {
+        return {192, 168, 1, 1};
+    }
+
+    IPAddress
+    subnetMask()
+    {
+        return {255, 255, 255, 0};
+    }
+
+    IPAddress
+    dnsIP(uint8_t index = 0)
+    {
+        return {192, 168, 1, 1};
+    }
+
+    uint8_t*
+    BSSID()
+    {
+        return _bssid;
+    }
+
+    int32_t
+    channel();
+
+    int32_t
+    RSSI()
+    {
+        return -60;
+    }
+
+private:
+    wl_status_t _status{WL_DISCONNECTED};
+    uint32_t _attempt{0};
+    bool _static{false};
+    uint8_t _bssid[6]{0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+};
+
+extern ESP8266WiFiClass WiFi;
+
+class WiFiClient : public Client {
+public:
+    WiFiClient() = default;
+
+    /* Takes ownership of the connected host socket */
+    explicit WiFiClient(int fd);
+
+    explicit operator bool() const
+    {
+        return (_socket != nullptr);
+    }
+
+    /* Connects the host socket to the server (e.g. the broker given to the simulation) */
+    int
+    connect(const char* host, uint16_t port) override;
+
+    uint8_t
+    connected() override;
+
+    int
+    available() override;
+
+    int
+    read() override;
+
+    int
+    read(uint8_t* buffer, size_t size) override;
+
+    /* Without host socket the data is discarded */
+    size_t
+    write(uint8_t c) override;
+
+    size_t
+    write(const uint8_t* buffer, size_t size) override;
+
+    using Print::write;
+
+    void
+    stop() override;
+
+    void
+    setNoDelay(bool noDelay);
+
+    bool
+    getNoDelay() const
+    {
+        return _noDelay;
+    }
+
+    /* Without host socket returns the free space of simulated send buffer of the broker link */
+    int
+    availableForWrite() override;
+
+private:
+    struct Socket;
+
+    std::shared_ptr<Socket> _socket;
+    bool _noDelay{false};
+};
+
+/* The TCP server listening on the host port */
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t port)
+        : _port{port}
+    {
+    }
+
+    ~WiFiServer();
+
+    void
+    begin();
+
+    void
+    setNoDelay(bool noDelay)
+    {
+        _noDelay = noDelay;
+    }
+
+    bool
+    hasClient();
+
+    /* Returns the next pending connection or an empty client */
+    WiFiClient
+    accept();
+
+private:
+    uint16_t _port;
+    int _fd{-1};
+    bool _noDelay{false};
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+/* The in-memory filesystem */
+
+#include <Arduino.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2,
+};
+
+struct FSInfo {
+    size_t totalBytes;
+    size_t usedBytes;
+    size_t blockSize;
+    size_t pageSize;
+};
+
+class File : public Stream {
+public:
+    File() = default;
+
+    File(std::shared_ptr<std::vector<uint8_t>> data, size_t position, bool writable)
+        : _data{std::move(data)}
+        , _position{position}
+        , _writable{writable}
+    {
+    }
+
+    explicit operator bool() const
+    {
+        return (_data != nullptr);
+    }
+
+    size_t
+    write(uint8_t c) override
+    {
+        return write(&c, 1);
+    }
+
+    size_t
+    write(const uint8_t* buffer, size_t size) override
+    {
+        if (!_data || !_writable) {
+            return 0;
+        }
+        if (_position + size > _data->size()) {
+            _data->resize(_position + size);
+        }
+        std::copy(buffer, buffer + size, _data->begin() + _position);
+        _position += size;
+        return size;
+    }
+
+    using Print::write;
+
+    int
+    available() override
+    {
+        return _data ? static_cast<int>(_data->size() - _position) : 0;
+    }
+
+    int
+    read() override
+    {
+        uint8_t c;
+        return (read(&c, 1) == 1) ? c : -1;
+    }
+
+    size_t
+    read(uint8_t* buffer, size_t size)
+    {
+        if (!_data || _position >= _data->size()) {
+            return 0;
+        }
+        size = std::min(size, _data->size() - _position);
+        std::copy(_data->begin() + _position, _data->begin() + _position + size, buffer);
+        _position += size;
+        return size;
+    }
+
+    bool
+    seek(uint32_t position, SeekMode mode = SeekSet)
+    {
+        if (!_data) {
+            return false;
+        }
+        const size_t base = (mode == SeekSet) ? 0 : (mode == SeekCur) ? _position : _data->size();
+        if (base + position > _data->size()) {
+            return false;
+        }
+        _position = base + position;
+        return true;
+    }
+
+    size_t
+    position() const
+    {
+        return _position;
+    }
+
+    size_t
+    size() const
+    {
+        return _data ? _data->size() : 0;
+    }
+
+    void
+    close()
+    {
+        _data.reset();
+    }
+
+private:
+    std::shared_ptr<std::vector<uint8_t>> _data;
+    size_t _position{0};
+    bool _writable{false};
+};
+
+class FS {
+public:
+    bool
+    begin()
+    {
+        return true;
+    }
+
+    void
+    end()
+    {
+    }
+
+    bool
+    format()
+    {
+        _files.clear();
+        return true;
+    }
+
+    File
+    open(const char* path, const char* mode)
+    {
+        auto it = _files.find(path);
+        if (mode[0] == 'r') {
+            if (it == _files.end()) {
+                return {};
+            }
+            return {it->second, 0, mode[1] == '+'};
+        }
+        if (it == _files.end() || mode[0] == 'w') {
+            it = _files.insert_or_assign(path, std::make_shared<std::vector<uint8_t>>()).first;
+        }
+        return {it->second, (mode[0] == 'a') ? it->second->size() : 0, true};
+    }
+
+    bool
+    exists(const char* path)
+    {
+        return (_files.count(path) > 0);
+    }
+
+    bool
+    remove(const char* path)
+    {
+        return (_files.erase(path) > 0);
+    }
+
+    bool
+    rename(const char* from, const char* to)
+    {
+        auto it = _files.find(from);
+        if (it == _files.end()) {
+            return false;
+        }
+        _files[to] = it->second;
+        _files.erase(it);
+        return true;
+    }
+
+    bool
+    info(FSInfo& info)
+    {
+        info = FSInfo{1024 * 1024, 0, 8192, 256};
+        for (const auto& file : _files) {
+            info.usedBytes += file.second->size();
+        }
+        return true;
+    }
+
+private:
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> _files;
+};
+
+extern FS LittleFS;
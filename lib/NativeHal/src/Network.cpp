@@ -0,0 +1,238 @@
+#include <ESP8266WiFi.h>
+
+#include "Simulation.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+namespace {
+
+void
+setNonBlocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+} // namespace
+
+struct WiFiClient::Socket {
+    explicit Socket(int descriptor)
+        : fd{descriptor}
+    {
+    }
+
+    ~Socket()
+    {
+        close();
+    }
+
+    void
+    close()
+    {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    int fd;
+};
+
+WiFiClient::WiFiClient(int fd)
+    : _socket{std::make_shared<Socket>(fd)}
+{
+    setNonBlocking(fd);
+}
+
+int
+WiFiClient::connect(const char* host, uint16_t port)
+{
+    stop();
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses{nullptr};
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &addresses) != 0) {
+        return 0;
+    }
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    const bool connected = (fd >= 0) && (::connect(fd, addresses->ai_addr, addresses->ai_addrlen) == 0);
+    freeaddrinfo(addresses);
+    if (!connected) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 0;
+    }
+    _socket = std::make_shared<Socket>(fd);
+    setNonBlocking(fd);
+    setNoDelay(_noDelay);
+    return 1;
+}
+
+uint8_t
+WiFiClient::connected()
+{
+    if (!_socket || _socket->fd < 0) {
+        return 0;
+    }
+    /* The connection is alive while it is not readable or has data to read */
+    uint8_t c;
+    const auto n = recv(_socket->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        _socket->close();
+        return 0;
+    }
+    return 1;
+}
+
+int
+WiFiClient::available()
+{
+    int count{0};
+    if (!_socket || _socket->fd < 0 || ioctl(_socket->fd, FIONREAD, &count) < 0) {
+        return 0;
+    }
+    return count;
+}
+
+int
+WiFiClient::read()
+{
+    uint8_t c;
+    return (read(&c, 1) == 1) ? c : -1;
+}
+
+int
+WiFiClient::read(uint8_t* buffer, size_t size)
+{
+    if (!_socket || _socket->fd < 0) {
+        return -1;
+    }
+    const auto n = recv(_socket->fd, buffer, size, MSG_DONTWAIT);
+    return (n < 0) ? -1 : static_cast<int>(n);
+}
+
+size_t
+WiFiClient::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t
+WiFiClient::write(const uint8_t* buffer, size_t size)
+{
+    if (!_socket) {
+        return size;
+    }
+    size_t written{0};
+    while (written < size && _socket->fd >= 0) {
+        const auto n = send(_socket->fd, buffer + written, size - written, MSG_NOSIGNAL);
+        if (n > 0) {
+            written += n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd descriptor{_socket->fd, POLLOUT, 0};
+            poll(&descriptor, 1, 100);
+        } else {
+            _socket->close();
+        }
+    }
+    return written;
+}
+
+int
+WiFiClient::availableForWrite()
+{
+    if (!_socket) {
+        return static_cast<int>(sim::uplinkAvailable());
+    }
+    /* The free space of the send buffer as lwIP sized it */
+    int unsent{0};
+    if (_socket->fd < 0 || ioctl(_socket->fd, SIOCOUTQ, &unsent) < 0) {
+        return 0;
+    }
+    return std::max(2 * 1460 - unsent, 0);
+}
+
+void
+WiFiClient::stop()
+{
+    if (_socket) {
+        _socket->close();
+    }
+}
+
+void
+WiFiClient::setNoDelay(bool noDelay)
+{
+    _noDelay = noDelay;
+    if (_socket && _socket->fd >= 0) {
+        int flag = noDelay ? 1 : 0;
+        setsockopt(_socket->fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+}
+
+WiFiServer::~WiFiServer()
+{
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+void
+WiFiServer::begin()
+{
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_fd < 0) {
+        perror("socket");
+        return;
+    }
+    int flag{1};
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(_port);
+    if (bind(_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(_fd, 4) < 0) {
+        perror("bind");
+        close(_fd);
+        _fd = -1;
+        return;
+    }
+    setNonBlocking(_fd);
+}
+
+bool
+WiFiServer::hasClient()
+{
+    pollfd descriptor{_fd, POLLIN, 0};
+    return (_fd >= 0) && (poll(&descriptor, 1, 0) > 0);
+}
+
+WiFiClient
+WiFiServer::accept()
+{
+    if (_fd < 0) {
+        return {};
+    }
+    const int fd = ::accept(_fd, nullptr, nullptr);
+    if (fd < 0) {
+        return {};
+    }
+    WiFiClient client{fd};
+    client.setNoDelay(_noDelay);
+    return client;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+/**
+ * The MQTT client delivering messages to the simulated broker which records the traffic
+ * and, if the simulation is given a broker, to the real one over the host socket.
+ */
+
+#include <Arduino.h>
+#include <Client.h>
+
+#include <functional>
+#include <string>
+
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+class PubSubClient : public Print {
+public:
+    explicit PubSubClient(Client& client)
+        : _client{client}
+    {
+    }
+
+    PubSubClient&
+    setServer(const char* domain, uint16_t port)
+    {
+        return *this;
+    }
+
+    PubSubClient&
+    setCallback(MQTT_CALLBACK_SIGNATURE)
+    {
+        _callback = std::move(callback);
+        return *this;
+    }
+
+    PubSubClient&
+    setSocketTimeout(uint16_t timeout)
+    {
+        return *this;
+    }
+
+    PubSubClient&
+    setKeepAlive(uint16_t keepAlive)
+    {
+        return *this;
+    }
+
+    bool
+    setBufferSize(uint16_t size)
+    {
+        _bufferSize = size;
+        return true;
+    }
+
+    uint16_t
+    getBufferSize()
+    {
+        return _bufferSize;
+    }
+
+    bool
+    connect(const char* id, const char* user, const char* pass);
+
+    void
+    disconnect();
+
+    bool
+    connected();
+
+    int
+    state()
+    {
+        return _state;
+    }
+
+    bool
+    loop();
+
+    bool
+    subscribe(const char* topic, uint8_t qos = 0);
+
+    bool
+    publish(const char* topic, const char* payload, bool retained = false)
+    {
+        return publish(topic, reinterpret_cast<const uint8_t*>(payload), strlen(payload), retained);
+    }
+
+    bool
+    publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained = false);
+
+    bool
+    beginPublish(const char* topic, unsigned int length, bool retained);
+
+    size_t
+    write(uint8_t c) override;
+
+    size_t
+    write(const uint8_t* buffer, size_t size) override;
+
+    int
+    endPublish();
+
+private:
+    /* Opens the connection to the broker given to the simulation and waits for CONNACK */
+    bool
+    connectBroker(const char* id, const char* user, const char* pass);
+
+    /* Writes the packet to the broker, returns false if the connection is lost */
+    bool
+    send(uint8_t header, const std::string& body);
+
+    /* Reads the received packets passing PUBLISH ones to the callback */
+    void
+    receive();
+
+private:
+    Client& _client;
+    std::function<void(char*, uint8_t*, unsigned int)> _callback;
+    std::string _received;
+    uint32_t _lastOut{0};
+    uint16_t _packetId{0};
+    uint16_t _bufferSize{MQTT_MAX_PACKET_SIZE};
+    int _state{MQTT_DISCONNECTED};
+    bool _connected{false};
+    std::string _topic;
+    std::string _payload;
+    unsigned int _length{0};
+    bool _retained{false};
+};
@@ -0,0 +1,422 @@
+#include "Simulation.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cinttypes>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t kDayMs = UINT64_C(24 * 60 * 60 * 1000);
+/* The TCP send buffer of lwIP on ESP8266 (TCP_SND_BUF) */
+constexpr size_t kSendBuffer = 2 * 1460;
+
+sim::Options Settings;
+sim::Stats Traffic;
+uint64_t Now{0};
+FILE* Trace{nullptr};
+
+/* The number of messages and bytes published during each simulated day */
+std::vector<sim::TopicStats> Days;
+
+/* The time the send buffer is drained at (fractional milliseconds) */
+double UplinkIdle{0.};
+
+/* The samples of the trace per source and the index of the next one to replay */
+std::vector<trace::Sample> Replay[static_cast<uint8_t>(trace::Source::Count)];
+size_t ReplayNext[static_cast<uint8_t>(trace::Source::Count)]{};
+
+/* The events scheduled by simulated devices ordered by time */
+std::multimap<uint64_t, std::function<void()>> Events;
+
+/* Waits for the host time to catch up with the clock advanced from the given time */
+void
+pace(uint64_t from)
+{
+    if (Settings.realtime && Now > from) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(Now - from));
+    }
+}
+
+/* Fires the earliest event not later than the time, returns false if there is none */
+bool
+fire(uint64_t until)
+{
+    if (Events.empty() || Events.begin()->first > until) {
+        return false;
+    }
+    auto callback = std::move(Events.begin()->second);
+    Now = std::max(Now, Events.begin()->first);
+    Events.erase(Events.begin());
+    callback();
+    return true;
+}
+
+#ifndef PIO_UNIT_TESTING
+/* The helpers of the simulator entry point, the unit tests (see test/) run their own main() */
+
+/* The run lasts as long as the trace unless the number of days is given */
+bool DaysGiven{false};
+
+/* Reads the trace into per source sample lists, returns the time of the last sample */
+bool
+loadReplay(const char* path, uint64_t& last)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        perror(path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t block[4096];
+    for (size_t size; (size = fread(block, 1, sizeof(block), file)) > 0;) {
+        data.insert(data.end(), block, block + size);
+    }
+    fclose(file);
+
+    if (data.size() < sizeof(trace::kMagic) || memcmp(data.data(), trace::kMagic, sizeof(trace::kMagic)) != 0) {
+        fprintf(stderr, "%s: not a trace\n", path);
+        return false;
+    }
+    trace::Decoder decoder;
+    trace::Sample sample{};
+    const uint8_t* position = data.data() + sizeof(trace::kMagic);
+    last = 0;
+    while (decoder.next(position, data.data() + data.size(), sample)) {
+        Replay[static_cast<uint8_t>(sample.source)].push_back(sample);
+        last = std::max<uint64_t>(last, sample.time);
+    }
+    return true;
+}
+
+void
+usage(const char* program)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --days <n>             simulated days to run (default: 1)\n"
+            "  --step-ms <n>          simulated time between loop calls (default: 20)\n"
+            "  --seed <n>             seed of the sensor noise (default: 1)\n"
+            "  --outage-period-h <n>  period of broker outages in hours (default: none)\n"
+            "  --outage-min <n>       duration of each broker outage in minutes\n"
+            "  --spike-period-h <n>   period of sudden CO2 and TVOC rises in hours (default: none)\n"
+            "  --uplink-bps <n>       throughput of the broker link in bytes per second (default: unlimited)\n"
+            "  --broker <host>        deliver the messages to the MQTT broker as well\n"
+            "  --broker-port <n>      port of the MQTT broker (default: 1883)\n"
+            "  --chip-id <n>          chip ID the device ID is derived from (default: 0xC0FFEE)\n"
+            "  --ap-channel <n>       channel of the WiFi access point (default: 6)\n"
+            "  --rtc <path>           keep RTC memory in the file between runs (warm boot)\n"
+            "  --trace <path>         write published messages to the file\n"
+            "  --replay <path>        feed the sensors with the recorded trace (runs as long as the trace)\n"
+            "  --verbose              print the serial output to stderr\n"
+            "  --realtime             run the clock at the pace of the host time\n",
+            program);
+}
+
+bool
+parse(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* name = argv[i];
+        if (strcmp(name, "--verbose") == 0) {
+            Settings.verbose = true;
+            continue;
+        }
+        if (strcmp(name, "--realtime") == 0) {
+            Settings.realtime = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+        if (strcmp(name, "--days") == 0) {
+            Settings.days = atof(value);
+            DaysGiven = true;
+        } else if (strcmp(name, "--step-ms") == 0) {
+            Settings.stepMs = std::max(1ul, strtoul(value, nullptr, 10));
+        } else if (strcmp(name, "--seed") == 0) {
+            Settings.seed = strtoul(value, nullptr, 10);
+        } else if (strcmp(name, "--outage-period-h") == 0) {
+            Settings.outagePeriodMs = static_cast<uint32_t>(atof(value) * 60 * 60 * 1000);
+        } else if (strcmp(name, "--outage-min") == 0) {
+            Settings.outageDurationMs = static_cast<uint32_t>(atof(value) * 60 * 1000);
+        } else if (strcmp(name, "--spike-period-h") == 0) {
+            Settings.spikePeriodMs = static_cast<uint32_t>(atof(value) * 60 * 60 * 1000);
+        } else if (strcmp(name, "--uplink-bps") == 0) {
+            Settings.uplinkBps = strtoul(value, nullptr, 10);
+        } else if (strcmp(name, "--broker") == 0) {
+            Settings.broker = value;
+        } else if (strcmp(name, "--broker-port") == 0) {
+            Settings.brokerPort = static_cast<uint16_t>(strtoul(value, nullptr, 10));
+        } else if (strcmp(name, "--chip-id") == 0) {
+            Settings.chipId = strtoul(value, nullptr, 0);
+        } else if (strcmp(name, "--ap-channel") == 0) {
+            Settings.apChannel = atoi(value);
+        } else if (strcmp(name, "--rtc") == 0) {
+            Settings.rtcPath = value;
+        } else if (strcmp(name, "--trace") == 0) {
+            Settings.tracePath = value;
+        } else if (strcmp(name, "--replay") == 0) {
+            Settings.replayPath = value;
+        } else {
+            return false;
+        }
+    }
+    return (Settings.days > 0.);
+}
+
+void
+report(double loopAvgUs, double loopMaxUs)
+{
+    const double days = static_cast<double>(Now) / kDayMs;
+
+    printf("Simulated: %.2f days, %" PRIu64 " ms\n", days, Now);
+    printf("Connects: %" PRIu32 ", failed publishes: %" PRIu32 "\n", Traffic.connects, Traffic.failures);
+    printf("Messages: %" PRIu32 " (%.1f per day)\n", Traffic.messages, Traffic.messages / days);
+    printf("Payload: %" PRIu64 " bytes (%.1f per day)\n", Traffic.payloadBytes, Traffic.payloadBytes / days);
+    printf("Frames: %" PRIu64 " bytes (%.1f per day)\n", Traffic.frameBytes, Traffic.frameBytes / days);
+    printf("First connect: %" PRIu64 " ms, first message: %" PRIu64 " ms after boot\n",
+           Traffic.firstConnectMs,
+           Traffic.firstMessageMs);
+    printf("Stalled writes: %" PRIu64 " ms, serial: %" PRIu64 " ms\n", Traffic.stalledMs, Traffic.serialStalledMs);
+    printf("Loop: %.2f us avg, %.2f us max (host)\n", loopAvgUs, loopMaxUs);
+    if (Settings.replayPath != nullptr) {
+        printf("Replayed: %zu of %zu BME680 samples, %zu of %zu CCS811 samples\n",
+               ReplayNext[static_cast<uint8_t>(trace::Source::Bme680)],
+               Replay[static_cast<uint8_t>(trace::Source::Bme680)].size(),
+               ReplayNext[static_cast<uint8_t>(trace::Source::Ccs811)],
+               Replay[static_cast<uint8_t>(trace::Source::Ccs811)].size());
+    }
+
+    printf("\nTopics:\n");
+    for (const auto& [topic, stats] : Traffic.topics) {
+        printf("  %-40s %8" PRIu32 " msgs %10" PRIu64 " bytes\n",
+               topic.c_str(),
+               stats.messages,
+               stats.bytes);
+    }
+
+    printf("\nDays:\n");
+    for (size_t day = 0; day < Days.size(); ++day) {
+        printf("  %-4zu %8" PRIu32 " msgs %10" PRIu64 " bytes\n",
+               day + 1,
+               Days[day].messages,
+               Days[day].bytes);
+    }
+}
+#endif
+
+} // namespace
+
+const sim::Options&
+sim::options()
+{
+    return Settings;
+}
+
+uint64_t
+sim::now()
+{
+    return Now;
+}
+
+void
+sim::advance(uint32_t ms)
+{
+    const auto from = Now;
+    const auto until = Now + ms;
+    while (fire(until)) {
+    }
+    Now = until;
+    pace(from);
+}
+
+void
+sim::sleep(uint32_t ms, const std::function<bool()>& blocked)
+{
+    const auto from = Now;
+    const auto until = Now + ms;
+    while (blocked()) {
+        if (!fire(until)) {
+            Now = until;
+            break;
+        }
+    }
+    pace(from);
+}
+
+void
+sim::schedule(uint64_t time, std::function<void()> callback)
+{
+    Events.emplace(time, std::move(callback));
+}
+
+bool
+sim::replaying()
+{
+    return (Settings.replayPath != nullptr);
+}
+
+uint64_t
+sim::replayNext(trace::Source source)
+{
+    const auto index = static_cast<uint8_t>(source);
+    return (ReplayNext[index] < Replay[index].size()) ? Replay[index][ReplayNext[index]].time : UINT64_MAX;
+}
+
+bool
+sim::replayTake(trace::Source source, trace::Sample& sample)
+{
+    const auto index = static_cast<uint8_t>(source);
+    bool taken{false};
+    while (ReplayNext[index] < Replay[index].size() && Replay[index][ReplayNext[index]].time <= Now) {
+        sample = Replay[index][ReplayNext[index]++];
+        taken = true;
+    }
+    return taken;
+}
+
+bool
+sim::brokerAvailable()
+{
+    if (Settings.outagePeriodMs == 0) {
+        return true;
+    }
+    /* The outage takes place at the end of each period */
+    const uint64_t phase = Now % Settings.outagePeriodMs;
+    return (phase + Settings.outageDurationMs < Settings.outagePeriodMs);
+}
+
+sim::Stats&
+sim::stats()
+{
+    return Traffic;
+}
+
+size_t
+sim::uplinkAvailable()
+{
+    if (Settings.uplinkBps == 0) {
+        return kSendBuffer;
+    }
+    const double pending = std::max(UplinkIdle - static_cast<double>(Now), 0.) * Settings.uplinkBps / 1000.;
+    return kSendBuffer - std::min(static_cast<size_t>(pending + 0.5), kSendBuffer);
+}
+
+void
+sim::uplinkSend(size_t size)
+{
+    if (Settings.uplinkBps == 0) {
+        return;
+    }
+    const auto available = uplinkAvailable();
+    if (size > available) {
+        /* The write returns once the bytes beyond the free space have left */
+        const auto wait = static_cast<uint32_t>(ceil((size - available) * 1000. / Settings.uplinkBps));
+        Traffic.stalledMs += wait;
+        advance(wait);
+    }
+    UplinkIdle = std::max(UplinkIdle, static_cast<double>(Now)) + size * 1000. / Settings.uplinkBps;
+}
+
+void
+sim::record(const std::string& topic, const uint8_t* payload, size_t length, size_t frameSize)
+{
+    if (Traffic.messages == 0) {
+        Traffic.firstMessageMs = Now;
+    }
+    Traffic.messages++;
+    Traffic.payloadBytes += length;
+    Traffic.frameBytes += frameSize;
+
+    auto& perTopic = Traffic.topics[topic];
+    perTopic.messages++;
+    perTopic.bytes += frameSize;
+
+    const auto day = static_cast<size_t>(Now / kDayMs);
+    if (Days.size() <= day) {
+        Days.resize(day + 1);
+    }
+    Days[day].messages++;
+    Days[day].bytes += frameSize;
+
+    if (Trace != nullptr) {
+        /* The line per message: <time ms> <topic> <payload in hex> */
+        fprintf(Trace, "%" PRIu64 " %s ", Now, topic.c_str());
+        for (size_t i = 0; i < length; ++i) {
+            fprintf(Trace, "%02x", payload[i]);
+        }
+        fputc('\n', Trace);
+    }
+}
+
+#ifndef PIO_UNIT_TESTING
+/* The firmware entry points */
+void
+setup();
+
+void
+loop();
+
+int
+main(int argc, char* argv[])
+{
+    if (!parse(argc, argv)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (Settings.tracePath != nullptr) {
+        Trace = fopen(Settings.tracePath, "w");
+        if (Trace == nullptr) {
+            perror(Settings.tracePath);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (Settings.replayPath != nullptr) {
+        uint64_t last{0};
+        if (!loadReplay(Settings.replayPath, last)) {
+            return EXIT_FAILURE;
+        }
+        if (!DaysGiven) {
+            Settings.days = static_cast<double>(last + Settings.stepMs) / kDayMs;
+        }
+    }
+
+    if (Settings.rtcPath != nullptr) {
+        sim::restoreRtc(Settings.rtcPath);
+    }
+
+    setup();
+
+    const auto duration = static_cast<uint64_t>(Settings.days * kDayMs);
+    uint64_t loops{0};
+    double totalUs{0.};
+    double maxUs{0.};
+    while (Now < duration) {
+        const auto begin = std::chrono::steady_clock::now();
+        loop();
+        const std::chrono::duration<double, std::micro> elapsed
+            = std::chrono::steady_clock::now() - begin;
+        totalUs += elapsed.count();
+        maxUs = std::max(maxUs, elapsed.count());
+        loops++;
+        sim::advance(Settings.stepMs);
+    }
+
+    report(loops > 0 ? totalUs / loops : 0., maxUs);
+
+    if (Settings.rtcPath != nullptr) {
+        sim::persistRtc(Settings.rtcPath);
+    }
+
+    if (Trace != nullptr) {
+        fclose(Trace);
+    }
+    return EXIT_SUCCESS;
+}
+#endif
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <Arduino.h>
+#include <TraceFormat.h>
+
+#include <functional>
+#include <map>
+#include <string>
+
+/**
+ * The simulated environment the native build runs in: the clock advanced by the driver
+ * instead of real time, the broker availability schedule and counters of MQTT traffic.
+ */
+namespace sim {
+
+struct Options {
+    double days{1.};
+    uint32_t stepMs{20};
+    uint32_t seed{1};
+    /* The period and duration of broker outages (0 - no outages) */
+    uint32_t outagePeriodMs{0};
+    uint32_t outageDurationMs{0};
+    /* The period of sudden air quality drops, e.g. a door closing on a crowded room (0 - none) */
+    uint32_t spikePeriodMs{0};
+    /* The broker to deliver the messages to besides recording them (nullptr - record only) */
+    const char* broker{nullptr};
+    uint16_t brokerPort{1883};
+    /* The chip ID the device identifier is derived from */
+    uint32_t chipId{0x00C0FFEE};
+    /* The channel of the access point */
+    int32_t apChannel{6};
+    /* The file RTC memory is kept in between runs (as if the device was reset) */
+    const char* rtcPath{nullptr};
+    /* The throughput of the broker link in bytes per second (0 - unlimited) */
+    uint32_t uplinkBps{0};
+    bool verbose{false};
+    /* Runs the clock at the pace of the host time (e.g. to query servers of the firmware) */
+    bool realtime{false};
+    const char* tracePath{nullptr};
+    /* The trace of raw readings to feed the sensors with instead of the models (see TraceFormat.h) */
+    const char* replayPath{nullptr};
+};
+
+struct TopicStats {
+    uint32_t messages{0};
+    uint64_t bytes{0};
+};
+
+struct Stats {
+    uint32_t connects{0};
+    uint32_t messages{0};
+    uint32_t failures{0};
+    uint64_t payloadBytes{0};
+    uint64_t frameBytes{0};
+    /* The time of the first broker connect and the first message since boot */
+    uint64_t firstConnectMs{0};
+    uint64_t firstMessageMs{0};
+    /* The time the writes waited for room in the send buffer */
+    uint64_t stalledMs{0};
+    /* The time the serial writes waited for room in the UART FIFO */
+    uint64_t serialStalledMs{0};
+    std::map<std::string, TopicStats> topics;
+};
+
+[[nodiscard]] const Options&
+options();
+
+/* Returns the simulated time in milliseconds since start */
+[[nodiscard]] uint64_t
+now();
+
+/* Advances the clock firing the scheduled events on the way */
+void
+advance(uint32_t ms);
+
+/* Advances the clock until the timeout passes or blocked() returns false after an event */
+void
+sleep(uint32_t ms, const std::function<bool()>& blocked);
+
+/* Fires the callback once the clock reaches the time */
+void
+schedule(uint64_t time, std::function<void()> callback);
+
+/* Calls the interrupt handler attached to the pin */
+void
+interrupt(uint8_t pin);
+
+/* Returns the normally distributed noise with given deviation */
+[[nodiscard]] double
+noise(double deviation);
+
+[[nodiscard]] bool
+brokerAvailable();
+
+[[nodiscard]] Stats&
+stats();
+
+/* Returns the free space of the TCP send buffer drained at the uplink throughput */
+[[nodiscard]] size_t
+uplinkAvailable();
+
+/* Puts the bytes into the send buffer advancing the clock while it has no room (blocking write) */
+void
+uplinkSend(size_t size);
+
+/* Returns true if the sensors are fed with the trace */
+[[nodiscard]] bool
+replaying();
+
+/* Returns the time of the next sample of the source in the trace (UINT64_MAX at the end) */
+[[nodiscard]] uint64_t
+replayNext(trace::Source source);
+
+/* Takes the latest sample of the source due by now skipping the older ones, returns false if none is due */
+[[nodiscard]] bool
+replayTake(trace::Source source, trace::Sample& sample);
+
+/* Loads RTC memory from the file if it exists (warm boot) */
+void
+restoreRtc(const char* path);
+
+/* Saves RTC memory to the file */
+void
+persistRtc(const char* path);
+
+/* Records the message delivered to the broker */
+void
+record(const std::string& topic, const uint8_t* payload, size_t length, size_t frameSize);
+
+} // namespace sim
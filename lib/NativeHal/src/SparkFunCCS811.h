@@ -0,0 +1,85 @@
+#pragma once
+
+/* The simulated CCS811 sensor */
+
+#include <Arduino.h>
+
+class CCS811Core {
+public:
+    enum CCS811_Status_e {
+        CCS811_Stat_SUCCESS,
+        CCS811_Stat_ID_ERROR,
+        CCS811_Stat_I2C_ERROR,
+        CCS811_Stat_INTERNAL_ERROR,
+        CCS811_Stat_GENERIC_ERROR,
+    };
+};
+
+class CCS811 : public CCS811Core {
+public:
+    explicit CCS811(uint8_t address = 0x5B)
+    {
+    }
+
+    void
+    setI2CAddress(uint8_t address)
+    {
+    }
+
+    bool
+    begin();
+
+    /* Reports new data once per second as the sensor in the drive mode 1 does */
+    bool
+    dataAvailable();
+
+    bool
+    checkForStatusError()
+    {
+        return false;
+    }
+
+    uint8_t
+    getErrorRegister()
+    {
+        return 0;
+    }
+
+    CCS811_Status_e
+    readAlgorithmResults();
+
+    CCS811_Status_e
+    setEnvironmentalData(float humidity, float temperature);
+
+    CCS811_Status_e
+    setDriveMode(uint8_t mode)
+    {
+        return CCS811_Stat_SUCCESS;
+    }
+
+    /* Drives the nINT pin when new data is available until the data is read */
+    CCS811_Status_e
+    enableInterrupts();
+
+    uint16_t
+    getCO2()
+    {
+        return _co2;
+    }
+
+    uint16_t
+    getTVOC()
+    {
+        return _tvoc;
+    }
+
+private:
+    void
+    raise();
+
+private:
+    uint32_t _nextData{0};
+    bool _interrupts{false};
+    uint16_t _co2{0};
+    uint16_t _tvoc{0};
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+
+/* The bus with devices acknowledging every transfer, the data of the simulated sensors does not pass it */
+class TwoWire : public Stream {
+public:
+    void
+    begin(int sda, int scl)
+    {
+    }
+
+    void
+    setClock(uint32_t frequency)
+    {
+    }
+
+    void
+    beginTransmission(uint8_t address)
+    {
+    }
+
+    uint8_t
+    endTransmission(bool sendStop = true)
+    {
+        return 0;
+    }
+
+    uint8_t
+    requestFrom(uint8_t address, uint8_t quantity)
+    {
+        _available = quantity;
+        return quantity;
+    }
+
+    size_t
+    write(uint8_t c) override
+    {
+        return 1;
+    }
+
+    using Print::write;
+
+    int
+    available() override
+    {
+        return _available;
+    }
+
+    int
+    read() override
+    {
+        if (_available == 0) {
+            return -1;
+        }
+        _available--;
+        return 0;
+    }
+
+private:
+    uint8_t _available{0};
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,110 @@
+#pragma once
+
+/* The simulated BME680 sensor driven by BSEC library */
+
+#include <Arduino.h>
+#include <Wire.h>
+
+typedef uint8_t bsec_virtual_sensor_t;
+typedef int bsec_library_return_t;
+
+typedef enum {
+    BME68X_SPI_INTF,
+    BME68X_I2C_INTF,
+} bme68x_intf;
+
+typedef int8_t (*bme68x_read_fptr_t)(uint8_t reg_addr, uint8_t* reg_data, uint32_t length, void* intf_ptr);
+typedef int8_t (*bme68x_write_fptr_t)(uint8_t reg_addr,
+                                      const uint8_t* reg_data,
+                                      uint32_t length,
+                                      void* intf_ptr);
+typedef void (*bme68x_delay_us_fptr_t)(uint32_t period, void* intf_ptr);
+
+#define BSEC_OK 0
+#define BSEC_W_SC_CALL_TIMING_VIOLATION 100
+#define BME68X_OK 0
+#define BSEC_MAX_STATE_BLOB_SIZE 221
+
+#define BSEC_SAMPLE_RATE_ULP (0.0033333f)
+#define BSEC_SAMPLE_RATE_LP (0.33333f)
+#define BSEC_SAMPLE_RATE_CONT (1.0f)
+
+enum {
+    BSEC_OUTPUT_IAQ = 1,
+    BSEC_OUTPUT_STATIC_IAQ,
+    BSEC_OUTPUT_CO2_EQUIVALENT,
+    BSEC_OUTPUT_BREATH_VOC_EQUIVALENT,
+    BSEC_OUTPUT_RAW_TEMPERATURE,
+    BSEC_OUTPUT_RAW_PRESSURE,
+    BSEC_OUTPUT_RAW_HUMIDITY,
+    BSEC_OUTPUT_RAW_GAS,
+    BSEC_OUTPUT_STABILIZATION_STATUS,
+    BSEC_OUTPUT_RUN_IN_STATUS,
+    BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_TEMPERATURE,
+    BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_HUMIDITY,
+    BSEC_OUTPUT_GAS_PERCENTAGE,
+};
+
+class Bsec {
+public:
+    void
+    begin(uint8_t address, TwoWire& wire);
+
+    /* Accesses the sensor registers through the callbacks on every measurement */
+    void
+    begin(bme68x_intf intf,
+          bme68x_read_fptr_t read,
+          bme68x_write_fptr_t write,
+          bme68x_delay_us_fptr_t idleTask,
+          void* intfPtr);
+
+    void
+    setConfig(const uint8_t* config);
+
+    void
+    setState(uint8_t* state);
+
+    void
+    getState(uint8_t* state);
+
+    void
+    updateSubscription(bsec_virtual_sensor_t* sensors, uint8_t count, float sampleRate);
+
+    /* Produces new outputs once the sample period has passed */
+    bool
+    run();
+
+    int64_t
+    getTimeMs();
+
+public:
+    int bsecStatus{BSEC_OK};
+    int8_t bme68xStatus{BME68X_OK};
+    int64_t nextCall{0};
+    float iaq{0.f};
+    float staticIaq{0.f};
+    uint8_t iaqAccuracy{0};
+    float co2Equivalent{0.f};
+    float breathVocEquivalent{0.f};
+    float rawTemperature{0.f};
+    float rawHumidity{0.f};
+    float temperature{0.f};
+    float humidity{0.f};
+    float pressure{0.f};
+    float gasResistance{0.f};
+    float gasPercentage{0.f};
+    float stabStatus{0.f};
+    float runInStatus{0.f};
+
+private:
+    /* Takes the outputs from the replayed trace instead of the model */
+    bool
+    replay();
+
+private:
+    bme68x_read_fptr_t _read{nullptr};
+    bme68x_write_fptr_t _write{nullptr};
+    void* _intfPtr{nullptr};
+    uint32_t _period{3000};
+    uint8_t _state[BSEC_MAX_STATE_BLOB_SIZE]{};
+};
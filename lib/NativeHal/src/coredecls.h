@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <functional>
+
+uint32_t
+crc32(const void* data, size_t length, uint32_t crc = 0xffffffff);
+
+/* Wakes up esp_delay() to check its condition, might be called from interrupt */
+void
+esp_schedule();
+
+/* Sleeps until the timeout passes or blocked() returns false after a wakeup */
+void
+esp_delay(uint32_t timeout, const std::function<bool()>& blocked);
@@ -0,0 +1,235 @@
+#pragma once
+
+/**
+ * The compact binary trace of raw sensor readings. The stream starts with the magic "ACT1"
+ * followed by the records:
+ *
+ *   <source: 1 byte> <time since the previous record, ms: varint> <fields: zigzag varints>
+ *
+ * The fields are the readings scaled to integers (see kScales) and stored as the difference
+ * from the previous reading of the same source, so the slowly changing values take a byte each.
+ * The sync record carries the time since boot instead of the difference and no fields, it resets
+ * the previous readings to zero. It starts the stream and repeats every kSyncPeriod records,
+ * so the decoding might start at any sync record (e.g. in the middle of serial capture).
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace trace {
+
+enum class Source : uint8_t {
+    Sync = 0,
+    Bme680,
+    Ccs811,
+    Count,
+};
+
+/* The fields of BME680 record in order: raw readings first, then the BSEC outputs */
+enum Bme680Field : uint8_t {
+    RawTemperature = 0,
+    RawHumidity,
+    Pressure,
+    GasResistance,
+    Temperature,
+    Humidity,
+    Iaq,
+    Co2Equivalent,
+    BreathVocEquivalent,
+    GasPercentage,
+    StabStatus,
+    RunInStatus,
+    Bme680FieldCount,
+};
+
+/* The fields of CCS811 record in order */
+enum Ccs811Field : uint8_t {
+    Co2 = 0,
+    Tvoc,
+    Ccs811FieldCount,
+};
+
+constexpr char kMagic[4] = {'A', 'C', 'T', '1'};
+
+/* The maximum number of fields of single record */
+constexpr uint8_t kFieldsMax = Bme680FieldCount;
+
+/* The maximum size of encoded record: source, time and fields of up to 5 bytes each */
+constexpr size_t kRecordMax = 1 + 5 + kFieldsMax * 5;
+
+/* The maximum size of single encode() output: the record preceded by sync record */
+constexpr size_t kEncodedMax = 1 + 5 + kRecordMax;
+
+/* The number of records between sync records */
+constexpr uint16_t kSyncPeriod = 256;
+
+/* The multipliers scaling the readings to integers (the resolution kept in the trace) */
+/* The resolution is about tenth of the deadband of the metric, so the replay crosses the deadbands as the device did */
+constexpr float kBme680Scales[Bme680FieldCount] = {100.f, 100.f, 1.f, 1.f, 100.f, 100.f, 100.f, 10.f, 1000.f, 10.f, 1.f, 1.f};
+constexpr float kCcs811Scales[Ccs811FieldCount] = {1.f, 1.f};
+
+inline uint8_t
+fieldCount(Source source)
+{
+    switch (source) {
+    case Source::Bme680:
+        return Bme680FieldCount;
+    case Source::Ccs811:
+        return Ccs811FieldCount;
+    default:
+        return 0;
+    }
+}
+
+inline const float*
+scales(Source source)
+{
+    return (source == Source::Bme680) ? kBme680Scales : kCcs811Scales;
+}
+
+/* The reading of single source at the time since boot */
+struct Sample {
+    Source source;
+    uint32_t time;
+    float fields[kFieldsMax];
+};
+
+/* Encodes the samples into records, the caller writes them out */
+class Encoder {
+public:
+    /* Encodes the sample preceded by sync record when it is due, returns the size written */
+    size_t
+    encode(const Sample& sample, uint8_t (&buffer)[kEncodedMax])
+    {
+        size_t size{0};
+        if (_records % kSyncPeriod == 0) {
+            buffer[size++] = static_cast<uint8_t>(Source::Sync);
+            size += putVarint(buffer + size, sample.time);
+            for (auto& last : _last) {
+                for (auto& field : last) {
+                    field = 0;
+                }
+            }
+            _time = sample.time;
+        }
+        _records++;
+
+        buffer[size++] = static_cast<uint8_t>(sample.source);
+        size += putVarint(buffer + size, sample.time - _time);
+        _time = sample.time;
+
+        const auto index = static_cast<uint8_t>(sample.source);
+        const float* scale = scales(sample.source);
+        for (uint8_t i = 0; i < fieldCount(sample.source); ++i) {
+            const auto value = static_cast<int32_t>(lroundf(sample.fields[i] * scale[i]));
+            size += putVarint(buffer + size, zigzag(value - _last[index][i]));
+            _last[index][i] = value;
+        }
+        return size;
+    }
+
+private:
+    static uint32_t
+    zigzag(int32_t value)
+    {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    static size_t
+    putVarint(uint8_t* buffer, uint32_t value)
+    {
+        size_t size{0};
+        while (value >= 0x80) {
+            buffer[size++] = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        buffer[size++] = static_cast<uint8_t>(value);
+        return size;
+    }
+
+private:
+    int32_t _last[static_cast<uint8_t>(Source::Count)][kFieldsMax]{};
+    uint32_t _time{0};
+    uint32_t _records{0};
+};
+
+/**
+ * Decodes the records, the data has to start with sync record. The time since boot going back
+ * at sync record means reboot, the sample times are shifted to keep growing then.
+ */
+class Decoder {
+public:
+    /**
+     * Decodes the next sample from the data advancing it, returns false at the end of data
+     * or on malformed record (the rest is skipped then).
+     */
+    bool
+    next(const uint8_t*& data, const uint8_t* end, Sample& sample)
+    {
+        while (data < end) {
+            const auto source = static_cast<Source>(*data++);
+            uint32_t time;
+            if (!getVarint(data, end, time)) {
+                return false;
+            }
+            if (source == Source::Sync) {
+                if (_synced && time + _offset < _time) {
+                    _offset = _time - time;
+                }
+                _synced = true;
+                _time = time + _offset;
+                for (auto& last : _last) {
+                    for (auto& field : last) {
+                        field = 0;
+                    }
+                }
+                continue;
+            }
+            if (!_synced || fieldCount(source) == 0) {
+                data = end;
+                return false;
+            }
+            _time += time;
+
+            const auto index = static_cast<uint8_t>(source);
+            const float* scale = scales(source);
+            for (uint8_t i = 0; i < fieldCount(source); ++i) {
+                uint32_t delta;
+                if (!getVarint(data, end, delta)) {
+                    return false;
+                }
+                _last[index][i] += static_cast<int32_t>((delta >> 1) ^ (0u - (delta & 1)));
+                sample.fields[i] = static_cast<float>(_last[index][i]) / scale[i];
+            }
+            sample.source = source;
+            sample.time = _time;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    static bool
+    getVarint(const uint8_t*& data, const uint8_t* end, uint32_t& value)
+    {
+        value = 0;
+        for (uint8_t shift = 0; data < end && shift < 35; shift += 7) {
+            const uint8_t byte = *data++;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        data = end;
+        return false;
+    }
+
+private:
+    int32_t _last[static_cast<uint8_t>(Source::Count)][kFieldsMax]{};
+    uint32_t _time{0};
+    uint32_t _offset{0};
+    bool _synced{false};
+};
+
+} // namespace trace
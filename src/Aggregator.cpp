@@ -0,0 +1,74 @@
+#include "Aggregator.hpp"
+
+#include <ArduinoJson.h>
+
+#include "DataSet.hpp"
+#include "Device.hpp"
+#include "Diagnostics.hpp"
+#include "Metric.hpp"
+#include "Publisher.hpp"
+#include "Sensor1.hpp"
+#include "Sensor2.hpp"
+#include "Stamp.hpp"
+
+Aggregator::Aggregator(Publisher& publisher, const DataSet& data)
+    : _publisher{publisher}
+    , _data{data}
+{
+}
+
+void
+Aggregator::publish(Sensor1& sensor1, Sensor2& sensor2)
+{
+    if (due() > 0) {
+        return;
+    }
+    _timestamp = millis();
+
+    Probe probe{Phase::Publish};
+
+#if AIROCAT_STAMP
+    static StaticJsonDocument<JSON_OBJECT_SIZE(kMetricCount) + sizeof(MetricInfo::key) * kMetricCount
+                              + kStampCapacity>
+        json;
+#else
+    static StaticJsonDocument<JSON_OBJECT_SIZE(kMetricCount) + sizeof(MetricInfo::key) * kMetricCount> json;
+#endif
+
+    json.clear();
+    JsonObject state = json.to<JsonObject>();
+    auto acquired = _timestamp;
+    sensor1.collect(state, acquired);
+    sensor2.collect(state, acquired);
+    if (state.size() == 0) {
+        return;
+    }
+#if AIROCAT_STAMP
+    /* The state is stamped with the time its oldest value was read */
+    stamp(json, acquired);
+#endif
+    char topic[64];
+    deviceTopic(kTopicName, topic, sizeof(topic));
+    const bool published = _publisher.publish(topic, json, false);
+#if AIROCAT_STAMP
+    if (published) {
+        stampTake();
+    }
+#endif
+    sensor1.commit(published);
+    sensor2.commit(published);
+}
+
+void
+Aggregator::trigger()
+{
+    _timestamp = millis() - _data.period();
+}
+
+uint32_t
+Aggregator::due() const
+{
+    const auto period = _data.period();
+    const auto elapsed = millis() - _timestamp;
+    return (elapsed < period) ? period - elapsed : 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+
+class DataSet;
+class Publisher;
+class Sensor1;
+class Sensor2;
+
+/**
+ * Gathers changed values of all sensors and publishes them as a single message
+ * to the state topic once per the shortest publish interval (see DataSet::period()).
+ */
+class Aggregator {
+public:
+    /* The topic name under the device prefix (see deviceTopic()) */
+    static constexpr const char* kTopicName = "state";
+
+    Aggregator(Publisher& publisher, const DataSet& data);
+
+    void
+    publish(Sensor1& sensor1, Sensor2& sensor2);
+
+    /* Makes the next publish() go out at once instead of waiting for the rest of period */
+    void
+    trigger();
+
+    /* Returns the number of milliseconds till the next publish */
+    [[nodiscard]] uint32_t
+    due() const;
+
+private:
+    Publisher& _publisher;
+    const DataSet& _data;
+    uint32_t _timestamp{0};
+};
@@ -0,0 +1,202 @@
+#include "Backlog.hpp"
+
+#if AIROCAT_BACKLOG
+
+#include "Stamp.hpp"
+
+#if AIROCAT_BACKLOG_SPILL
+#include <LittleFS.h>
+
+#include "Diagnostics.hpp"
+#include "Log.hpp"
+#endif
+
+namespace {
+
+#if AIROCAT_BACKLOG_SPILL
+/* The file to spill the oldest samples to */
+const char* kSpillPath = "/backlog.bin";
+/* The maximum size of spill file in bytes */
+constexpr const auto kSpillLimit = size_t{64 * 1024};
+#endif
+
+} // namespace
+
+void
+Backlog::setup()
+{
+#if AIROCAT_BACKLOG_SPILL
+    if (!LittleFS.begin()) {
+        LOG_ERROR("Backlog: Unable to mount filesystem");
+        return;
+    }
+    /* Timestamps of spilled samples are relative to the previous boot */
+    if (LittleFS.exists(kSpillPath)) {
+        LittleFS.remove(kSpillPath);
+    }
+#endif
+}
+
+void
+Backlog::push(Metric metric, float value, uint32_t timestamp)
+{
+    if (metric >= Metric::Count) {
+        return;
+    }
+    if (_count == AIROCAT_BACKLOG) {
+        overflow();
+    }
+#if AIROCAT_STAMP
+    /* The value is buffered right after the message stamped for it failed to be published */
+    const Sample sample{timestamp, stampTake(), value, metric};
+#else
+    const Sample sample{timestamp, value, metric};
+#endif
+    _samples[(_head + _count) % AIROCAT_BACKLOG] = sample;
+    _count++;
+}
+
+bool
+Backlog::empty() const
+{
+    return (size() == 0);
+}
+
+size_t
+Backlog::size() const
+{
+#if AIROCAT_BACKLOG_SPILL
+    return _spillCount + _count;
+#else
+    return _count;
+#endif
+}
+
+uint32_t
+Backlog::dropped() const
+{
+    return _dropped;
+}
+
+size_t
+Backlog::peek(JsonArray batch, size_t count) const
+{
+    const auto now = millis();
+
+    JsonObject group;
+    size_t taken{0};
+#if AIROCAT_BACKLOG_SPILL
+    if (_spillCount > 0) {
+        /* The spilled samples are read in a single pass over the file kept open for the batch */
+        File file = LittleFS.open(kSpillPath, "r");
+        if (!file || !file.seek(_spillHead * sizeof(Sample))) {
+            return 0;
+        }
+        const auto spilled = std::min(count, _spillCount);
+        for (Sample sample; taken < spilled; ++taken) {
+            if (file.read(reinterpret_cast<uint8_t*>(&sample), sizeof(Sample)) != sizeof(Sample)) {
+                return taken;
+            }
+            group = append(batch, group, sample, now);
+        }
+    }
+#endif
+    for (size_t index = 0; taken < count && index < _count; ++index, ++taken) {
+        group = append(batch, group, _samples[(_head + index) % AIROCAT_BACKLOG], now);
+    }
+    return taken;
+}
+
+void
+Backlog::pop(size_t count)
+{
+#if AIROCAT_BACKLOG_SPILL
+    const auto spilled = std::min(count, _spillCount);
+    _spillHead += spilled;
+    _spillCount -= spilled;
+    count -= spilled;
+    if (spilled > 0 && _spillCount == 0) {
+        LittleFS.remove(kSpillPath);
+        _spillHead = 0;
+    }
+#endif
+    count = std::min(count, _count);
+    _head = (_head + count) % AIROCAT_BACKLOG;
+    _count -= count;
+}
+
+JsonObject
+Backlog::append(JsonArray batch, JsonObject group, const Sample& sample, uint32_t now) const
+{
+    char key[sizeof(MetricInfo::key)];
+    metricKey(sample.metric, key);
+    const auto age = (now - sample.timestamp) / 1000;
+#if AIROCAT_STAMP
+    const bool fresh = group.isNull() || group["seq"].as<uint32_t>() != sample.sequence;
+#else
+    const bool fresh = group.isNull();
+#endif
+    if (fresh || group["age"].as<uint32_t>() != age || group.containsKey(key)) {
+        group = batch.createNestedObject();
+        group["age"] = age;
+#if AIROCAT_STAMP
+        group["seq"] = sample.sequence;
+        JsonArray time = group.createNestedArray("time");
+        time.add(stampTime(sample.timestamp));
+        time.add(stampTime(now));
+#endif
+    }
+    group[key] = sample.value;
+    return group;
+}
+
+void
+Backlog::overflow()
+{
+#if AIROCAT_BACKLOG_SPILL
+    if (spill()) {
+        return;
+    }
+#endif
+    /* Drop the oldest sample */
+    _head = (_head + 1) % AIROCAT_BACKLOG;
+    _count--;
+    _dropped++;
+}
+
+#if AIROCAT_BACKLOG_SPILL
+bool
+Backlog::spill()
+{
+    Probe probe{Phase::Storage};
+
+    /* Move the oldest half of the buffer to the file with one write per contiguous run */
+    const auto count = std::max<size_t>(_count / 2, 1);
+    if ((_spillHead + _spillCount + count) * sizeof(Sample) > kSpillLimit) {
+        return false;
+    }
+
+    File file = LittleFS.open(kSpillPath, "a");
+    if (!file) {
+        return false;
+    }
+    /* The oldest samples run up to the end of the ring and wrap to its start at most once */
+    auto remaining = count;
+    while (remaining > 0) {
+        const auto run = std::min<size_t>(remaining, AIROCAT_BACKLOG - _head);
+        const auto size = run * sizeof(Sample);
+        const auto written = file.write(reinterpret_cast<const uint8_t*>(&_samples[_head]), size);
+        const auto samples = written / sizeof(Sample);
+        _spillCount += samples;
+        _head = (_head + samples) % AIROCAT_BACKLOG;
+        _count -= samples;
+        remaining -= samples;
+        if (written != size) {
+            break;
+        }
+    }
+    return (_count < AIROCAT_BACKLOG);
+}
+#endif
+
+#endif
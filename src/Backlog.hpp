@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "Metric.hpp"
+
+#if AIROCAT_BACKLOG
+/**
+ * Bounded ring buffer of timestamped samples which were not published because of
+ * connection outage. When the buffer is full, the oldest samples are spilled to LittleFS
+ * (if AIROCAT_BACKLOG_SPILL is enabled) or dropped otherwise.
+ */
+class Backlog {
+public:
+    Backlog() = default;
+
+    void
+    setup();
+
+    /* Keeps the value acquired at the timestamp (millis()) */
+    void
+    push(Metric metric, float value, uint32_t timestamp);
+
+    [[nodiscard]] bool
+    empty() const;
+
+    [[nodiscard]] size_t
+    size() const;
+
+    [[nodiscard]] uint32_t
+    dropped() const;
+
+    /**
+     * Fills the batch with up to count oldest samples grouped by the second they were taken in:
+     * [{"age": <seconds ago>, "<key>": <value>, ...}, ...]
+     * With AIROCAT_STAMP the samples are grouped by the message they failed to be published in,
+     * each group carries its stamp: {"age": ..., "seq": <n>, "time": [<acquired>, <sent>], ...}
+     * Returns the number of samples taken.
+     */
+    size_t
+    peek(JsonArray batch, size_t count) const;
+
+    /* Removes count oldest samples */
+    void
+    pop(size_t count);
+
+private:
+    struct Sample {
+        uint32_t timestamp;
+#if AIROCAT_STAMP
+        uint32_t sequence;
+#endif
+        float value;
+        Metric metric;
+    };
+
+    /* Adds the sample to the group or starts a new one, returns the group the sample went to */
+    JsonObject
+    append(JsonArray batch, JsonObject group, const Sample& sample, uint32_t now) const;
+
+    void
+    overflow();
+
+#if AIROCAT_BACKLOG_SPILL
+    bool
+    spill();
+#endif
+
+private:
+    Sample _samples[AIROCAT_BACKLOG]{};
+    size_t _head{0};
+    size_t _count{0};
+#if AIROCAT_BACKLOG_SPILL
+    size_t _spillHead{0};
+    size_t _spillCount{0};
+#endif
+    uint32_t _dropped{0};
+};
+
+#endif
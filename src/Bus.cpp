@@ -0,0 +1,80 @@
+#include "Bus.hpp"
+
+#include <Wire.h>
+
+Bus::Transaction::Transaction(Bus& bus, BusDevice device, size_t bytes)
+    : _bus{bus}
+    , _device{device}
+    , _bytes{bytes}
+    , _start{ESP.getCycleCount()}
+{
+}
+
+Bus::Transaction::~Transaction()
+{
+    _bus.account(_device, _bytes, ESP.getCycleCount() - _start, _failed);
+}
+
+void
+Bus::Transaction::fail()
+{
+    _failed = true;
+}
+
+void
+Bus::setup(int sda, int scl)
+{
+    Wire.begin(sda, scl);
+}
+
+int8_t
+Bus::read(BusDevice device, uint8_t address, uint8_t reg, uint8_t* data, size_t length)
+{
+    const auto start = ESP.getCycleCount();
+
+    /* The register address is written without stop condition followed by repeated start */
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    bool failed = (Wire.endTransmission(false) != 0);
+    if (!failed) {
+        failed = (Wire.requestFrom(address, static_cast<uint8_t>(length)) != length);
+        for (size_t i = 0; i < length; ++i) {
+            data[i] = (Wire.available() > 0) ? Wire.read() : 0;
+        }
+    }
+
+    account(device, 1 + length, ESP.getCycleCount() - start, failed);
+    return failed ? -1 : 0;
+}
+
+int8_t
+Bus::write(BusDevice device, uint8_t address, uint8_t reg, const uint8_t* data, size_t length)
+{
+    const auto start = ESP.getCycleCount();
+
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    Wire.write(data, length);
+    const bool failed = (Wire.endTransmission() != 0);
+
+    account(device, 1 + length, ESP.getCycleCount() - start, failed);
+    return failed ? -1 : 0;
+}
+
+const Bus::Counters&
+Bus::counters(BusDevice device) const
+{
+    return _counters[static_cast<uint8_t>(device)];
+}
+
+void
+Bus::account(BusDevice device, size_t bytes, uint32_t cycles, bool failed)
+{
+    Counters& counters = _counters[static_cast<uint8_t>(device)];
+    counters.transactions++;
+    counters.bytes += bytes;
+    counters.us += cycles / ESP.getCpuFreqMHz();
+    if (failed) {
+        counters.errors++;
+    }
+}
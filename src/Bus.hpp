@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+
+/* The devices sharing the I2C bus */
+enum class BusDevice : uint8_t {
+    Bme680 = 0,
+    Ccs811,
+    Count,
+};
+
+/**
+ * Owns the I2C bus and accounts the transactions, transferred bytes, errors and time
+ * spent per device. The BME680 registers are accessed through read() and write(),
+ * the CCS811 driver accesses the bus on its own, so its calls are accounted by Transaction.
+ */
+class Bus {
+public:
+    struct Counters {
+        uint32_t transactions;
+        uint32_t bytes;
+        uint32_t errors;
+        uint32_t us;
+    };
+
+    /* Accounts the driver call performing single transaction of known size */
+    class Transaction {
+    public:
+        Transaction(Bus& bus, BusDevice device, size_t bytes);
+
+        ~Transaction();
+
+        Transaction(const Transaction&) = delete;
+
+        Transaction&
+        operator=(const Transaction&) = delete;
+
+        void
+        fail();
+
+    private:
+        Bus& _bus;
+        BusDevice _device;
+        size_t _bytes;
+        uint32_t _start;
+        bool _failed{false};
+    };
+
+    Bus() = default;
+
+    void
+    setup(int sda, int scl);
+
+    /* Reads the registers starting from the given one, returns 0 on success */
+    int8_t
+    read(BusDevice device, uint8_t address, uint8_t reg, uint8_t* data, size_t length);
+
+    /* Writes the registers starting from the given one, returns 0 on success */
+    int8_t
+    write(BusDevice device, uint8_t address, uint8_t reg, const uint8_t* data, size_t length);
+
+    /* Returns the counters since boot */
+    [[nodiscard]] const Counters&
+    counters(BusDevice device) const;
+
+private:
+    void
+    account(BusDevice device, size_t bytes, uint32_t cycles, bool failed);
+
+private:
+    Counters _counters[static_cast<uint8_t>(BusDevice::Count)]{};
+};
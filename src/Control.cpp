@@ -0,0 +1,161 @@
+#include "Control.hpp"
+
+#if AIROCAT_CONTROL
+
+#include <ArduinoJson.h>
+
+#include "DataSet.hpp"
+#include "Device.hpp"
+#include "Journal.hpp"
+#include "Log.hpp"
+#include "Publisher.hpp"
+
+namespace {
+
+/* The capacity of single command, enough for the global members and a few metrics */
+constexpr auto kCommandCapacity = JSON_OBJECT_SIZE(8) + 4 * (JSON_OBJECT_SIZE(2) + JSON_ARRAY_SIZE(2)) + 192;
+
+/**
+ * The layout of saved settings: the format revision, the number of metrics and the optional fields.
+ * Bump the revision on any change of the Settings struct, the journal checks the size only.
+ */
+constexpr const auto kSettingsVersion = UINT32_C(1) | (uint32_t{kMetricCount} << 8) | ((AIROCAT_EVENTS ? 1u : 0u) << 16);
+
+/* The shortest interval accepted, the sensors are not read more often anyway */
+constexpr const auto kIntervalMin = UINT32_C(1000);
+
+/* The document to parse commands in (kept static to keep the stack of MQTT callback small) */
+StaticJsonDocument<kCommandCapacity> Command;
+
+/* The copies of the settings in LittleFS */
+Journal SettingsJournal{"/control"};
+
+} // namespace
+
+Control::Control(Publisher& publisher, DataSet& data)
+    : _publisher{publisher}
+    , _data{data}
+{
+}
+
+void
+Control::setup()
+{
+    if (!SettingsJournal.setup()
+        || !SettingsJournal.load(reinterpret_cast<uint8_t*>(&_settings), sizeof(_settings))) {
+        reset();
+    } else if (_settings.version != kSettingsVersion) {
+        LOG_WARNING("Control: Discarding saved settings of another layout");
+        reset();
+    } else {
+        LOG_INFO("Control: Applying saved settings");
+    }
+    apply();
+
+    deviceTopic(kTopicName, _topic, sizeof(_topic));
+    _publisher.subscribe(_topic, [this](const char*, const uint8_t* payload, size_t length) {
+        handle(payload, length);
+    });
+}
+
+bool
+Control::loop()
+{
+    if (_changed) {
+        _changed = false;
+        apply();
+        if (!SettingsJournal.save(reinterpret_cast<const uint8_t*>(&_settings), sizeof(_settings))) {
+            LOG_ERROR("Control: Unable to save settings");
+        }
+    }
+    if (_snapshot) {
+        _snapshot = false;
+        _data.refresh();
+        return true;
+    }
+    return false;
+}
+
+void
+Control::handle(const uint8_t* payload, size_t length)
+{
+    const auto error = deserializeJson(Command, payload, length);
+    if (error) {
+        LOG_WARNING("Control: Invalid command: %s", error.c_str());
+        return;
+    }
+
+    for (JsonPair member : Command.as<JsonObject>()) {
+        const char* key = member.key().c_str();
+        const JsonVariant value = member.value();
+        Metric metric;
+        if (strcmp(key, "snapshot") == 0) {
+            _snapshot = value.as<bool>();
+        } else if (strcmp(key, "reset") == 0) {
+            if (value.as<bool>()) {
+                reset();
+                _changed = true;
+            }
+        } else if (strcmp(key, "interval") == 0) {
+            const auto interval = std::max(value.as<uint32_t>(), kIntervalMin);
+            for (auto& item : _settings.intervals) {
+                item = interval;
+            }
+            _changed = true;
+        } else if (strcmp(key, "heartbeat") == 0) {
+            _settings.heartbeat = value.as<uint32_t>();
+            _changed = true;
+        } else if (metricFind(key, metric)) {
+            const auto index = static_cast<uint8_t>(metric);
+            if (value["interval"].is<uint32_t>()) {
+                _settings.intervals[index] = std::max(value["interval"].as<uint32_t>(), kIntervalMin);
+            }
+            if (value["deadband"].is<JsonArray>()) {
+                _settings.absolute[index] = value["deadband"][0].as<float>();
+                _settings.relative[index] = value["deadband"][1].as<float>();
+            }
+#if AIROCAT_EVENTS
+            if (value["event"].is<JsonArray>()) {
+                _settings.deviation[index] = value["event"][0].as<float>();
+                _settings.slope[index] = value["event"][1].as<float>();
+            }
+#endif
+            _changed = true;
+        } else {
+            LOG_WARNING("Control: Unknown member: %s", key);
+        }
+    }
+}
+
+void
+Control::reset()
+{
+    _settings.version = kSettingsVersion;
+    for (uint8_t index = 0; index < kMetricCount; ++index) {
+        const auto info = metricInfo(static_cast<Metric>(index));
+        _settings.intervals[index] = AIROCAT_DELAY;
+        _settings.absolute[index] = info.absolute;
+        _settings.relative[index] = info.relative;
+#if AIROCAT_EVENTS
+        _settings.deviation[index] = info.deviation;
+        _settings.slope[index] = info.slope;
+#endif
+    }
+    _settings.heartbeat = AIROCAT_HEARTBEAT;
+}
+
+void
+Control::apply()
+{
+    for (uint8_t index = 0; index < kMetricCount; ++index) {
+        const auto metric = static_cast<Metric>(index);
+        _data.setInterval(metric, _settings.intervals[index]);
+        _data.setDeadband(metric, _settings.absolute[index], _settings.relative[index]);
+#if AIROCAT_EVENTS
+        _data.setEvent(metric, _settings.deviation[index], _settings.slope[index]);
+#endif
+    }
+    _data.setHeartbeat(_settings.heartbeat);
+}
+
+#endif
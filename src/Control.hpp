@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "Metric.hpp"
+
+#if AIROCAT_CONTROL
+
+class DataSet;
+class Publisher;
+
+/**
+ * Applies the commands received on the command topic (see deviceTopic()) to the data set:
+ *   {"interval": <ms>, "heartbeat": <ms>, "snapshot": true, "reset": true,
+ *    "<metric key>": {"interval": <ms>, "deadband": [<absolute>, <relative>], "event": [<deviation>, <slope>]}}
+ * The global interval applies to all metrics, the members are applied in order, so the metric
+ * specific ones might follow it. The settings are kept in LittleFS and applied again after reboot.
+ */
+class Control {
+public:
+    /* The topic name under the device prefix (see deviceTopic()) */
+    static constexpr const char* kTopicName = "set";
+
+    Control(Publisher& publisher, DataSet& data);
+
+    /* Applies the saved settings and subscribes to the command topic */
+    void
+    setup();
+
+    /* Saves the changed settings, returns true once the snapshot of all values has been requested */
+    bool
+    loop();
+
+private:
+    struct Settings {
+        /* The layout of the record, the saved one of another layout is discarded (see kSettingsVersion) */
+        uint32_t version;
+        uint32_t intervals[kMetricCount];
+        float absolute[kMetricCount];
+        float relative[kMetricCount];
+#if AIROCAT_EVENTS
+        float deviation[kMetricCount];
+        float slope[kMetricCount];
+#endif
+        uint32_t heartbeat;
+    };
+
+    /* Parses the command, it is called from the MQTT client, so publishing and saving are deferred */
+    void
+    handle(const uint8_t* payload, size_t length);
+
+    void
+    reset();
+
+    void
+    apply();
+
+private:
+    Publisher& _publisher;
+    DataSet& _data;
+    /* The subscription keeps the pointer, so the topic lives as long as the control */
+    char _topic[64];
+    Settings _settings{};
+    bool _changed{false};
+    bool _snapshot{false};
+};
+
+#endif
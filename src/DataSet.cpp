@@ -0,0 +1,498 @@
+#include "DataSet.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include "Diagnostics.hpp"
+#include "Encoding.hpp"
+#include "Log.hpp"
+#include "Publisher.hpp"
+#include "Stamp.hpp"
+#if AIROCAT_WARM_BOOT
+#include "Rtc.hpp"
+#endif
+
+namespace {
+
+/* The scales to round values to the metric precision */
+constexpr double kScales[] = {1., 10., 100., 1000.};
+
+constexpr uint16_t
+mask(uint8_t index)
+{
+    return static_cast<uint16_t>(1u << index);
+}
+
+uint8_t
+indexOf(Metric metric)
+{
+    return static_cast<uint8_t>(metric);
+}
+
+Metric
+metricOf(uint8_t index)
+{
+    return static_cast<Metric>(index);
+}
+
+/* Rounds the value to the precision to keep payload free of float noise */
+double
+rounded(float value, uint8_t precision)
+{
+    const double scale = kScales[std::min<uint8_t>(precision, 3)];
+    return floor(value * scale + 0.5) / scale;
+}
+
+#if AIROCAT_EVENTS
+/* The time constants of the short-term and long-term averages and of the slope smoothing */
+constexpr const auto kFastPeriod = 10000.f;
+constexpr const auto kSlowPeriod = 300000.f;
+constexpr const auto kSlopePeriod = 10000.f;
+
+/* Returns the weight of the new value in the exponential average with the time constant */
+float
+weight(uint32_t elapsed, float period)
+{
+    return static_cast<float>(elapsed) / (period + static_cast<float>(elapsed));
+}
+#endif
+
+#if AIROCAT_WARM_BOOT
+/* The last published values kept in RTC memory */
+struct Snapshot {
+    float references[kMetricCount];
+    /* The milliseconds passed since the value was published as of the snapshot */
+    uint32_t ages[kMetricCount];
+    uint16_t published;
+};
+static_assert(rtcFits<Snapshot>(RtcSlot::Values, RtcSlot::Bsec), "The snapshot overlaps the next RTC slot");
+#endif
+
+} // namespace
+
+DataSet::DataSet(Publisher& publisher)
+    : _publisher{publisher}
+{
+    for (uint8_t index = 0; index < kMetricCount; ++index) {
+        const auto info = metricInfo(metricOf(index));
+        _values[index] = _references[index] = info.initial;
+        _absolute[index] = info.absolute;
+        _relative[index] = info.relative;
+        _intervals[index] = AIROCAT_DELAY;
+#if AIROCAT_EVENTS
+        _deviation[index] = info.deviation;
+        _slope[index] = info.slope;
+#endif
+    }
+}
+
+void
+DataSet::set(Metric metric, float value)
+{
+    const auto index = indexOf(metric);
+    if (_values[index] != value) {
+        _version++;
+    }
+    _values[index] = value;
+#if AIROCAT_STAMP || AIROCAT_BACKLOG
+    _acquired[index] = millis();
+#endif
+#if AIROCAT_STATISTICS
+    accumulate(index);
+#endif
+#if AIROCAT_EVENTS
+    const bool tripped = detect(index);
+#else
+    const bool tripped = false;
+#endif
+    if (changed(index) || tripped) {
+        _published &= ~mask(index);
+#if AIROCAT_BACKLOG
+        _buffered &= ~mask(index);
+#endif
+    }
+}
+
+float
+DataSet::get(Metric metric) const
+{
+    return _values[indexOf(metric)];
+}
+
+bool
+DataSet::published(Metric metric) const
+{
+    const auto index = indexOf(metric);
+    if ((_published & mask(index)) == 0) {
+        return false;
+    }
+    if (_heartbeat > 0) {
+        return (millis() - _timestamps[index] < _heartbeat);
+    }
+    return true;
+}
+
+uint32_t
+DataSet::version() const
+{
+    return _version;
+}
+
+void
+DataSet::setDeadband(Metric metric, float absolute, float relative)
+{
+    _absolute[indexOf(metric)] = absolute;
+    _relative[indexOf(metric)] = relative;
+}
+
+void
+DataSet::setHeartbeat(uint32_t period)
+{
+    _heartbeat = period;
+}
+
+void
+DataSet::setInterval(Metric metric, uint32_t period)
+{
+    _intervals[indexOf(metric)] = period;
+}
+
+#if AIROCAT_EVENTS
+void
+DataSet::setEvent(Metric metric, float deviation, float slope)
+{
+    _deviation[indexOf(metric)] = deviation;
+    _slope[indexOf(metric)] = slope;
+}
+
+bool
+DataSet::tripped() const
+{
+    const auto now = millis();
+    for (uint8_t index = 0; index < kMetricCount; ++index) {
+        if (released(index, now)) {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+uint32_t
+DataSet::period() const
+{
+    return *std::min_element(std::begin(_intervals), std::end(_intervals));
+}
+
+void
+DataSet::refresh()
+{
+    const auto now = millis();
+    _published = 0;
+    for (uint8_t index = 0; index < kMetricCount; ++index) {
+        _checks[index] = now - _intervals[index];
+    }
+}
+
+void
+DataSet::publish(Metric first, Metric last, bool stabilized)
+{
+    Probe probe{Phase::Publish};
+
+#if AIROCAT_STAMP
+    static StaticJsonDocument<JSON_OBJECT_SIZE(2) + kStampCapacity> json;
+#else
+    static StaticJsonDocument<JSON_OBJECT_SIZE(2)> json;
+#endif
+    char topic[64];
+
+    const auto now = millis();
+    for (auto index = indexOf(first); index <= indexOf(last); ++index) {
+        if (!due(index, now) || published(metricOf(index))) {
+            continue;
+        }
+        const auto info = metricInfo(metricOf(index));
+        if (info.gated && !stabilized) {
+            continue;
+        }
+
+        json.clear();
+#if AIROCAT_ENCODING == AIROCAT_ENCODING_MSGPACK
+        /* The compact form: [<metric id>, <value>] */
+        json.add(index);
+        json.add(rounded(_values[index], info.precision));
+#else
+        json[kFieldCaption] = info.caption;
+        json[kFieldValue] = rounded(_values[index], info.precision);
+#endif
+#if AIROCAT_STAMP
+        stamp(json, _acquired[index]);
+#endif
+        metricTopic(metricOf(index), topic, sizeof(topic));
+        if (_publisher.publish(topic, json, false)) {
+#if AIROCAT_STAMP
+            stampTake();
+#endif
+            confirm(index);
+        } else {
+            buffer(index);
+        }
+    }
+#if AIROCAT_WARM_BOOT
+    snapshot();
+#endif
+}
+
+void
+DataSet::collect(JsonObject state, Metric first, Metric last, bool stabilized, uint32_t& acquired)
+{
+    const auto now = millis();
+    for (auto index = indexOf(first); index <= indexOf(last); ++index) {
+        if (!due(index, now) || published(metricOf(index))) {
+            continue;
+        }
+        auto info = metricInfo(metricOf(index));
+        if (info.gated && !stabilized) {
+            continue;
+        }
+        /* The non-const key is copied into the document */
+        state[info.key] = rounded(_values[index], info.precision);
+        _collected |= mask(index);
+#if AIROCAT_STAMP || AIROCAT_BACKLOG
+        if (now - _acquired[index] > now - acquired) {
+            acquired = _acquired[index];
+        }
+#endif
+    }
+}
+
+void
+DataSet::commit(Metric first, Metric last, bool published)
+{
+    for (auto index = indexOf(first); index <= indexOf(last); ++index) {
+        if ((_collected & mask(index)) == 0) {
+            continue;
+        }
+        _collected &= ~mask(index);
+        if (published) {
+            confirm(index);
+        } else {
+            buffer(index);
+        }
+    }
+#if AIROCAT_WARM_BOOT
+    snapshot();
+#endif
+}
+
+#if AIROCAT_WARM_BOOT
+void
+DataSet::restore()
+{
+    Snapshot data;
+    if (!rtcLoad(RtcSlot::Values, data)) {
+        return;
+    }
+    const auto now = millis();
+    for (uint8_t index = 0; index < kMetricCount; ++index) {
+        if ((data.published & mask(index)) != 0) {
+            _values[index] = _references[index] = data.references[index];
+            /* The time spent in reset is unknown, the heartbeat counts from the snapshot */
+            _timestamps[index] = now - data.ages[index];
+        }
+    }
+    _published = data.published;
+}
+#endif
+
+#if AIROCAT_HTTP_PORT
+void
+DataSet::expose(Print& output, Metric first, Metric last, bool stabilized) const
+{
+    char name[48];
+
+    for (auto index = indexOf(first); index <= indexOf(last); ++index) {
+        const auto info = metricInfo(metricOf(index));
+        if (info.gated && !stabilized) {
+            continue;
+        }
+        metricName(metricOf(index), name, sizeof(name));
+        /* The pieces are printed one by one as printf() allocates for long lines */
+        output.print("# HELP "), output.print(name), output.print(' '), output.print(info.caption);
+        output.print("\n# TYPE "), output.print(name), output.print(" gauge\n");
+        output.print(name), output.print(' ');
+        output.print(rounded(_values[index], info.precision), info.precision);
+        output.print('\n');
+    }
+}
+#endif
+
+#if AIROCAT_STATISTICS
+void
+DataSet::summarize(JsonObject state, Metric first, Metric last, bool stabilized)
+{
+    for (auto index = indexOf(first); index <= indexOf(last); ++index) {
+        Window& window = _windows[index];
+        if (window.count == 0) {
+            continue;
+        }
+        auto info = metricInfo(metricOf(index));
+        if (!info.gated || stabilized) {
+            const float variance = (window.count > 1) ? window.m2 / (window.count - 1) : 0.f;
+            /* The non-const key is copied into the document */
+            JsonArray values = state.createNestedArray(info.key);
+            values.add(rounded(window.min, info.precision));
+            values.add(rounded(window.mean, info.precision));
+            values.add(rounded(window.max, info.precision));
+            values.add(rounded(sqrtf(variance), info.precision + 1));
+            values.add(window.count);
+        }
+        window = Window{};
+    }
+}
+#endif
+
+bool
+DataSet::changed(uint8_t index) const
+{
+    const float delta = fabsf(_values[index] - _references[index]);
+    if (_absolute[index] == 0.f && _relative[index] == 0.f) {
+        return (delta != 0.f);
+    }
+    return (delta > std::max(_absolute[index], _relative[index] * fabsf(_references[index])));
+}
+
+bool
+DataSet::due(uint8_t index, uint32_t now)
+{
+    if (now - _checks[index] < _intervals[index]) {
+#if AIROCAT_EVENTS
+        if (!released(index, now)) {
+            return false;
+        }
+        _alerted[index] = now;
+#else
+        return false;
+#endif
+    }
+    _checks[index] = now;
+#if AIROCAT_EVENTS
+    _tripped &= ~mask(index);
+#endif
+    return true;
+}
+
+void
+DataSet::confirm(uint8_t index)
+{
+    _references[index] = _values[index];
+    _published |= mask(index);
+    _timestamps[index] = millis();
+#if AIROCAT_WARM_BOOT
+    _confirmed = true;
+#endif
+}
+
+#if AIROCAT_EVENTS
+bool
+DataSet::detect(uint8_t index)
+{
+    const float value = _values[index];
+    const auto now = millis();
+    if ((_primed & mask(index)) == 0) {
+        _primed |= mask(index);
+        _fast[index] = _slow[index] = value;
+        _slopes[index] = 0.f;
+        _sampled[index] = now;
+        return false;
+    }
+    const auto elapsed = now - _sampled[index];
+    if (elapsed == 0) {
+        return false;
+    }
+    _sampled[index] = now;
+
+    /* The slope follows the short-term average, so the noise of single readings does not trip it */
+    const float previous = _fast[index];
+    _fast[index] += (value - _fast[index]) * weight(elapsed, kFastPeriod);
+    _slow[index] += (value - _slow[index]) * weight(elapsed, kSlowPeriod);
+    const float slope = (_fast[index] - previous) * 60000.f / static_cast<float>(elapsed);
+    _slopes[index] += (slope - _slopes[index]) * weight(elapsed, kSlopePeriod);
+
+    const bool exceeded = (_deviation[index] > 0.f && fabsf(_fast[index] - _slow[index]) > _deviation[index])
+                          || (_slope[index] > 0.f && fabsf(_slopes[index]) > _slope[index]);
+    /* Only the crossing trips the event, while the threshold stays exceeded the value goes out as usual */
+    const bool crossed = exceeded && (_exceeded & mask(index)) == 0;
+    if (exceeded) {
+        _exceeded |= mask(index);
+    } else {
+        _exceeded &= ~mask(index);
+    }
+    if (!crossed) {
+        return false;
+    }
+    char key[sizeof(MetricInfo::key)];
+    metricKey(metricOf(index), key);
+    LOG_DEBUG("Event: %s tripped at %.1f", key, static_cast<double>(value));
+    _tripped |= mask(index);
+    return true;
+}
+
+bool
+DataSet::released(uint8_t index, uint32_t now) const
+{
+    return ((_tripped & mask(index)) != 0 && now - _alerted[index] >= AIROCAT_EVENTS);
+}
+#endif
+
+void
+DataSet::buffer(uint8_t index)
+{
+    /* Keeps the value in the backlog to be published once connection is restored */
+#if AIROCAT_BACKLOG
+    if ((_buffered & mask(index)) == 0) {
+        _publisher.backlog().push(metricOf(index), _values[index], _acquired[index]);
+        _references[index] = _values[index];
+        _buffered |= mask(index);
+    }
+#endif
+}
+
+#if AIROCAT_STATISTICS
+void
+DataSet::accumulate(uint8_t index)
+{
+    const float value = _values[index];
+    Window& window = _windows[index];
+    if (window.count == 0) {
+        window.min = window.max = value;
+    } else {
+        window.min = std::min(window.min, value);
+        window.max = std::max(window.max, value);
+    }
+    window.count++;
+    const float delta = value - window.mean;
+    window.mean += delta / window.count;
+    window.m2 += delta * (value - window.mean);
+}
+#endif
+
+#if AIROCAT_WARM_BOOT
+void
+DataSet::snapshot()
+{
+    if (!_confirmed) {
+        return;
+    }
+    _confirmed = false;
+
+    Snapshot data{};
+    const auto now = millis();
+    for (uint8_t index = 0; index < kMetricCount; ++index) {
+        data.references[index] = _references[index];
+        data.ages[index] = now - _timestamps[index];
+    }
+    data.published = _published;
+    rtcSave(RtcSlot::Values, data);
+}
+#endif
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "Metric.hpp"
+
+class Publisher;
+
+/**
+ * Keeps the values of all metrics described by the metric table in packed arrays and
+ * publishes the changed ones. The publish related operations are applied to the range
+ * of metrics [first, last] owned by particular sensor.
+ */
+class DataSet {
+public:
+    static constexpr const char* kFieldCaption = "caption";
+    static constexpr const char* kFieldValue = "value";
+
+    explicit DataSet(Publisher& publisher);
+
+    void
+    set(Metric metric, float value);
+
+    [[nodiscard]] float
+    get(Metric metric) const;
+
+    [[nodiscard]] bool
+    published(Metric metric) const;
+
+    /* Returns the counter of value changes, it differs once any value has changed */
+    [[nodiscard]] uint32_t
+    version() const;
+
+    /**
+     * Sets the change threshold: the value is considered changed when it differs from the last
+     * published one by more than the absolute delta or the relative part of the last value.
+     */
+    void
+    setDeadband(Metric metric, float absolute, float relative = 0.f);
+
+    /* Sets the maximum period of silence, the value is republished after it even if unchanged */
+    void
+    setHeartbeat(uint32_t period);
+
+    /* Sets the minimum period between checks of the value for changes to publish (AIROCAT_DELAY by default) */
+    void
+    setInterval(Metric metric, uint32_t period);
+
+    /* Returns the shortest of the intervals, the period of the messages carrying all metrics */
+    [[nodiscard]] uint32_t
+    period() const;
+
+#if AIROCAT_EVENTS
+    /**
+     * Sets the event thresholds: the event trips when the short-term average of the value starts
+     * to depart from the long-term one by more than the deviation or to change faster than the slope
+     * per minute.
+     * The tripped value is published at once regardless of its interval and deadband, but not more
+     * often than once per AIROCAT_EVENTS milliseconds (the held one goes out with the next reading).
+     */
+    void
+    setEvent(Metric metric, float deviation, float slope);
+
+    /* Returns true if any tripped value is ready to go out before its interval */
+    [[nodiscard]] bool
+    tripped() const;
+#endif
+
+    /* Makes all values due for publishing at the next publish() or collect() even if unchanged */
+    void
+    refresh();
+
+    void
+    publish(Metric first, Metric last, bool stabilized);
+
+    /* Adds the due values to the state, lowers acquired to the time the oldest of them was read */
+    void
+    collect(JsonObject state, Metric first, Metric last, bool stabilized, uint32_t& acquired);
+
+    void
+    commit(Metric first, Metric last, bool published);
+
+#if AIROCAT_WARM_BOOT
+    /**
+     * Restores the last published values and their publish times kept in RTC memory,
+     * so the values which have not changed during reset are not republished.
+     */
+    void
+    restore();
+#endif
+
+#if AIROCAT_HTTP_PORT
+    /* Writes the current values in Prometheus text exposition format */
+    void
+    expose(Print& output, Metric first, Metric last, bool stabilized) const;
+#endif
+
+#if AIROCAT_STATISTICS
+    /**
+     * Adds the statistics of values set since the previous call to the state and starts new window:
+     * {"<key>": [<min>, <mean>, <max>, <stddev>, <count>], ...}
+     */
+    void
+    summarize(JsonObject state, Metric first, Metric last, bool stabilized);
+#endif
+
+private:
+    [[nodiscard]] bool
+    changed(uint8_t index) const;
+
+    /* Returns true once per interval of the value, the skipped values keep waiting even if changed */
+    [[nodiscard]] bool
+    due(uint8_t index, uint32_t now);
+
+    void
+    confirm(uint8_t index);
+
+#if AIROCAT_EVENTS
+    /* Updates the averages and the slope with the new value, returns true if the event trips */
+    bool
+    detect(uint8_t index);
+
+    /* Returns true if the value has tripped the event and the previous event is long enough ago */
+    [[nodiscard]] bool
+    released(uint8_t index, uint32_t now) const;
+#endif
+
+    void
+    buffer(uint8_t index);
+
+#if AIROCAT_STATISTICS
+    void
+    accumulate(uint8_t index);
+#endif
+
+#if AIROCAT_WARM_BOOT
+    /* Saves the last published values to RTC memory if any of them has been confirmed */
+    void
+    snapshot();
+#endif
+
+private:
+#if AIROCAT_STATISTICS
+    /* The streaming statistics of values within the window (Welford's algorithm) */
+    struct Window {
+        uint32_t count;
+        float min;
+        float max;
+        float mean;
+        float m2;
+    };
+#endif
+
+    Publisher& _publisher;
+    float _values[kMetricCount]{};
+    float _references[kMetricCount]{};
+    float _absolute[kMetricCount]{};
+    float _relative[kMetricCount]{};
+    uint32_t _timestamps[kMetricCount]{};
+    uint32_t _intervals[kMetricCount]{};
+    uint32_t _checks[kMetricCount]{};
+#if AIROCAT_STAMP || AIROCAT_BACKLOG
+    /* The times the values were read */
+    uint32_t _acquired[kMetricCount]{};
+#endif
+#if AIROCAT_EVENTS
+    float _deviation[kMetricCount]{};
+    float _slope[kMetricCount]{};
+    /* The exponentially weighted short-term and long-term averages and the slope (per minute) */
+    float _fast[kMetricCount]{};
+    float _slow[kMetricCount]{};
+    float _slopes[kMetricCount]{};
+    uint32_t _sampled[kMetricCount]{};
+    /* The times of the last event publishes */
+    uint32_t _alerted[kMetricCount]{};
+    uint16_t _primed{0};
+    uint16_t _exceeded{0};
+    uint16_t _tripped{0};
+#endif
+    uint32_t _heartbeat{AIROCAT_HEARTBEAT};
+    uint32_t _version{0};
+    uint16_t _published{0};
+    uint16_t _collected{0};
+#if AIROCAT_WARM_BOOT
+    bool _confirmed{false};
+#endif
+#if AIROCAT_BACKLOG
+    uint16_t _buffered{0};
+#endif
+#if AIROCAT_STATISTICS
+    Window _windows[kMetricCount]{};
+#endif
+};
@@ -0,0 +1,32 @@
+#include "Device.hpp"
+
+namespace {
+
+/* The root of the MQTT topics to publish to */
+const char* kTopicRoot = "airocat";
+
+} // namespace
+
+const char*
+deviceId()
+{
+    static char id[32]{};
+    if (id[0] == '\0') {
+        if (strlen(AIROCAT_DEVICE_ID) > 0) {
+            strncpy(id, AIROCAT_DEVICE_ID, sizeof(id) - 1);
+        } else {
+            snprintf(id, sizeof(id), "airocat-%06x", ESP.getChipId());
+        }
+    }
+    return id;
+}
+
+void
+deviceTopic(const char* name, char* topic, size_t size)
+{
+#if AIROCAT_NAMESPACE
+    snprintf(topic, size, "%s/%s/%s", kTopicRoot, deviceId(), name);
+#else
+    snprintf(topic, size, "%s/%s", kTopicRoot, name);
+#endif
+}
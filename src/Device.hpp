@@ -0,0 +1,14 @@
+#pragma once
+
+#include <Arduino.h>
+
+/* Returns the device identifier: AIROCAT_DEVICE_ID if set or derived from the chip ID (airocat-xxxxxx) */
+[[nodiscard]] const char*
+deviceId();
+
+/**
+ * Formats the MQTT topic of the device: airocat/<name> or, with AIROCAT_NAMESPACE enabled,
+ * airocat/<device id>/<name>, so the devices sharing a broker do not overwrite each other.
+ */
+void
+deviceTopic(const char* name, char* topic, size_t size);
@@ -0,0 +1,181 @@
+#include "Diagnostics.hpp"
+
+#if AIROCAT_DIAGNOSTICS
+
+#include <ArduinoJson.h>
+
+#include "Bus.hpp"
+#include "Device.hpp"
+#include "Log.hpp"
+#include "Publisher.hpp"
+
+namespace {
+
+/* The names of phases in the diagnostics payload */
+const char* kPhaseNames[] = {"loop", "sensor1", "sensor2", "publish", "connect", "storage"};
+
+constexpr auto kPhaseCount = static_cast<uint8_t>(Phase::Count);
+
+/* The names of I2C devices in the diagnostics payload */
+const char* kDeviceNames[] = {"bme680", "ccs811"};
+
+constexpr auto kDeviceCount = static_cast<uint8_t>(BusDevice::Count);
+
+/* The log-scaled histogram with two buckets per power of two (up to 8 s) */
+constexpr uint8_t kBuckets = 48;
+
+/* The statistics of the phase durations in microseconds within current window */
+struct PhaseStats {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[kBuckets];
+};
+
+PhaseStats Stats[kPhaseCount]{};
+
+uint8_t
+bucketOf(uint32_t us)
+{
+    if (us < 2) {
+        return us;
+    }
+    const uint8_t msb = 31 - __builtin_clz(us);
+    const uint8_t index = 2 * msb + ((us >> (msb - 1)) & 1);
+    return std::min<uint8_t>(index, kBuckets - 1);
+}
+
+/* Returns the largest value falling into the bucket */
+uint32_t
+bucketBound(uint8_t index)
+{
+    if (index < 2) {
+        return index;
+    }
+    const uint8_t msb = index / 2;
+    const uint32_t lower = (UINT32_C(2) | (index & 1)) << (msb - 1);
+    return lower + (UINT32_C(1) << (msb - 1)) - 1;
+}
+
+uint32_t
+percentile(const PhaseStats& stats, uint8_t percent)
+{
+    const uint32_t rank = (static_cast<uint64_t>(stats.count) * percent + 99) / 100;
+    uint32_t seen{0};
+    for (uint8_t index = 0; index < kBuckets; ++index) {
+        seen += stats.buckets[index];
+        if (seen >= rank) {
+            /* The bound of the bucket overestimates, the exact maximum caps it */
+            return std::min(bucketBound(index), stats.max);
+        }
+    }
+    return stats.max;
+}
+
+} // namespace
+
+void
+diagnosticsRecord(Phase phase, uint32_t cycles)
+{
+    const uint32_t us = cycles / ESP.getCpuFreqMHz();
+    PhaseStats& stats = Stats[static_cast<uint8_t>(phase)];
+    if (stats.count == 0 || us < stats.min) {
+        stats.min = us;
+    }
+    if (us > stats.max) {
+        stats.max = us;
+    }
+    stats.count++;
+    stats.sum += us;
+    stats.buckets[bucketOf(us)]++;
+}
+
+Diagnostics::Diagnostics(Publisher& publisher, const Bus& bus)
+    : _publisher{publisher}
+    , _bus{bus}
+{
+}
+
+void
+Diagnostics::publish()
+{
+    if (due() > 0) {
+        return;
+    }
+    const auto currTimestamp = millis();
+    const auto delay = currTimestamp - _timestamp;
+    _timestamp = currTimestamp;
+
+    static StaticJsonDocument<JSON_OBJECT_SIZE(10) + JSON_OBJECT_SIZE(kPhaseCount)
+                              + kPhaseCount * JSON_ARRAY_SIZE(4) + JSON_OBJECT_SIZE(kDeviceCount)
+                              + kDeviceCount * JSON_ARRAY_SIZE(4) + JSON_ARRAY_SIZE(4)>
+        json;
+
+    const auto freeHeap = ESP.getFreeHeap();
+    _minFreeHeap = std::min(_minFreeHeap, freeHeap);
+
+    json.clear();
+    json["uptime"] = currTimestamp / 1000;
+    /* The number of loop() calls per second */
+    json["rate"] = Stats[0].count * 1000.f / delay;
+    json["heap"] = freeHeap;
+    json["heapMin"] = _minFreeHeap;
+    json["block"] = ESP.getMaxFreeBlockSize();
+    json["fragmentation"] = ESP.getHeapFragmentation();
+    /* The minimum of free stack since boot */
+    json["stack"] = ESP.getFreeContStack();
+
+    /* The durations in microseconds: [min, avg, max, p99] */
+    JsonObject phases = json.createNestedObject("phases");
+    for (uint8_t index = 0; index < kPhaseCount; ++index) {
+        const PhaseStats& stats = Stats[index];
+        if (stats.count == 0) {
+            continue;
+        }
+        JsonArray timings = phases.createNestedArray(kPhaseNames[index]);
+        timings.add(stats.min);
+        timings.add(static_cast<uint32_t>(stats.sum / stats.count));
+        timings.add(stats.max);
+        timings.add(percentile(stats, 99));
+    }
+
+    /* The I2C bus counters: [transactions, bytes, errors, microseconds] */
+    JsonObject bus = json.createNestedObject("bus");
+    for (uint8_t index = 0; index < kDeviceCount; ++index) {
+        const auto& counters = _bus.counters(static_cast<BusDevice>(index));
+        JsonArray values = bus.createNestedArray(kDeviceNames[index]);
+        values.add(counters.transactions);
+        values.add(counters.bytes);
+        values.add(counters.errors);
+        values.add(counters.us);
+    }
+
+#if AIROCAT_QUEUE
+    /* The outbound queue: [messages, bytes, peak bytes, rejected messages] */
+    const auto& outbox = _publisher.outbox();
+    JsonArray queue = json.createNestedArray("queue");
+    queue.add(outbox.count());
+    queue.add(outbox.size());
+    queue.add(outbox.peak());
+    queue.add(outbox.rejected());
+#endif
+
+    char topic[64];
+    deviceTopic(kTopicName, topic, sizeof(topic));
+    /* The outage is reported by the Publisher, only a failure while connected is logged */
+    if (!_publisher.publish(topic, json, false) && _publisher.connected()) {
+        LOG_WARNING("Unable to publish diagnostics");
+    }
+
+    memset(Stats, 0, sizeof(Stats));
+}
+
+uint32_t
+Diagnostics::due() const
+{
+    const auto elapsed = millis() - _timestamp;
+    return (elapsed < AIROCAT_DIAGNOSTICS) ? AIROCAT_DIAGNOSTICS - elapsed : 0;
+}
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+
+/* The parts of loop() measured separately, the phases might nest (e.g. Sensor1 includes Storage) */
+enum class Phase : uint8_t {
+    /* The whole loop() call */
+    Loop = 0,
+    /* The BSEC processing of BME680 */
+    Sensor1,
+    /* The polling of CCS811 */
+    Sensor2,
+    /* The publishing of values, discovery configs and backlog */
+    Publish,
+    /* The WiFi and MQTT connection maintenance */
+    Connect,
+    /* The journal writes and backlog spills */
+    Storage,
+    Count,
+};
+
+/* Adds the duration (in CPU cycles) of single phase run to the statistics of current window */
+void
+diagnosticsRecord(Phase phase, uint32_t cycles);
+
+/**
+ * Measures the phase run from construction till destruction using CPU cycle counter.
+ * Costs nothing when diagnostics is disabled.
+ */
+class Probe {
+public:
+    explicit Probe(Phase phase)
+#if AIROCAT_DIAGNOSTICS
+        : _phase{phase}
+        , _start{ESP.getCycleCount()}
+#endif
+    {
+    }
+
+    ~Probe()
+    {
+#if AIROCAT_DIAGNOSTICS
+        diagnosticsRecord(_phase, ESP.getCycleCount() - _start);
+#endif
+    }
+
+    Probe(const Probe&) = delete;
+
+    Probe&
+    operator=(const Probe&) = delete;
+
+#if AIROCAT_DIAGNOSTICS
+private:
+    Phase _phase;
+    uint32_t _start;
+#endif
+};
+
+#if AIROCAT_DIAGNOSTICS
+
+class Bus;
+class Publisher;
+
+/**
+ * Publishes the timings of loop() phases (min/avg/max/p99 in microseconds), the loop frequency,
+ * the free heap, the largest free block, the stack high-water mark and the I2C bus counters
+ * to the diagnostics topic once per AIROCAT_DIAGNOSTICS. The timings are collected anew
+ * for every period, the bus counters are accumulated since boot.
+ */
+class Diagnostics {
+public:
+    /* The topic name under the device prefix (see deviceTopic()) */
+    static constexpr const char* kTopicName = "diag";
+
+    Diagnostics(Publisher& publisher, const Bus& bus);
+
+    void
+    publish();
+
+    /* Returns the number of milliseconds till the next publish */
+    [[nodiscard]] uint32_t
+    due() const;
+
+private:
+    Publisher& _publisher;
+    const Bus& _bus;
+    uint32_t _timestamp{0};
+    uint32_t _minFreeHeap{UINT32_MAX};
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include "Discovery.hpp"
+
+#if HOMEASSISTANT_INTEGRATE
+
+#include "Aggregator.hpp"
+#include "Device.hpp"
+#include "Diagnostics.hpp"
+#include "Log.hpp"
+#include "Publisher.hpp"
+#include "Rtc.hpp"
+
+namespace {
+
+/* The topic HomeAssistant announces its (re)start to */
+const char* kStatusTopic = "homeassistant/status";
+
+/* The capacity of single entity config */
+constexpr auto kConfigCapacity = JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(4) + 448;
+
+/* The document to build entity config in (shared to keep the memory footprint low) */
+StaticJsonDocument<kConfigCapacity> Config;
+
+/* Computes FNV-1a hash of everything written */
+class HashWriter : public Print {
+public:
+    size_t
+    write(uint8_t c) override
+    {
+        _hash = (_hash ^ c) * UINT32_C(16777619);
+        return 1;
+    }
+
+    [[nodiscard]] uint32_t
+    hash() const
+    {
+        return _hash;
+    }
+
+private:
+    uint32_t _hash{UINT32_C(2166136261)};
+};
+
+static_assert(rtcFits<uint32_t>(RtcSlot::Discovery, RtcSlot::Wifi), "The hash overlaps the next RTC slot");
+
+} // namespace
+
+Discovery::Discovery(Publisher& publisher)
+    : _publisher{publisher}
+{
+}
+
+void
+Discovery::setup()
+{
+    if (!rtcLoad(RtcSlot::Discovery, _hash)) {
+        _hash = 0;
+    }
+
+    _publisher.subscribe(kStatusTopic, [this](const char*, const uint8_t* payload, size_t length) {
+        /* The restarted HomeAssistant might have lost the configs if broker does not retain them */
+        if (length == 6 && memcmp(payload, "online", 6) == 0) {
+            _pending = true;
+        }
+    });
+}
+
+void
+Discovery::loop()
+{
+    if (_pending && _publisher.connected()) {
+        _pending = false;
+        publish(true);
+    }
+    if (_next < kMetricCount && _publisher.connected()) {
+        send();
+    }
+}
+
+void
+Discovery::publish(bool force)
+{
+    const auto currHash = hash();
+    if (!force && currHash == _hash) {
+        return;
+    }
+    _target = currHash;
+    _next = 0;
+    send();
+}
+
+void
+Discovery::send()
+{
+    Probe probe{Phase::Publish};
+
+    char topic[96];
+    while (_next < kMetricCount) {
+        build(static_cast<Metric>(_next), Config, topic, sizeof(topic));
+        if (!_publisher.publish(topic, Config)) {
+            /* The rest is retried once the queue frees up or the connection is restored */
+            LOG_DEBUG("Unable to register: %s", topic);
+            return;
+        }
+        _next++;
+    }
+    _hash = _target;
+    rtcSave(RtcSlot::Discovery, _hash);
+}
+
+uint32_t
+Discovery::hash()
+{
+    char topic[96];
+
+    HashWriter writer;
+    for (uint8_t index = 0; index < kMetricCount; ++index) {
+        build(static_cast<Metric>(index), Config, topic, sizeof(topic));
+        writer.print(topic);
+        serializeJson(Config, writer);
+    }
+    return writer.hash();
+}
+
+void
+Discovery::build(Metric metric, JsonDocument& json, char* topic, size_t size)
+{
+    /* The strings of non-const info and local buffers are copied into the document */
+    auto info = metricInfo(metric);
+
+    char uniqueId[56];
+    snprintf(uniqueId, sizeof(uniqueId), "%s-%s", deviceId(), info.key);
+    char stateTopic[64];
+    char valueTemplate[80];
+
+    json.clear();
+    json["name"] = info.caption;
+    json["unique_id"] = uniqueId;
+    if (info.deviceClass[0] != '\0') {
+        json["device_class"] = info.deviceClass;
+    }
+    if (info.unit[0] != '\0') {
+        json["unit_of_measurement"] = info.unit;
+    }
+    json["entity_category"] = "diagnostic";
+#if AIROCAT_AGGREGATE
+    /* The state message carries only changed values, so keep the current state for others */
+    deviceTopic(Aggregator::kTopicName, stateTopic, sizeof(stateTopic));
+    json["state_topic"] = stateTopic;
+    snprintf(valueTemplate,
+             sizeof(valueTemplate),
+             "{{ value_json.%s | default(this.state) }}",
+             info.key);
+#else
+    metricTopic(metric, stateTopic, sizeof(stateTopic));
+    json["state_topic"] = stateTopic;
+    snprintf(valueTemplate, sizeof(valueTemplate), "{{ value_json.value }}");
+#endif
+    json["value_template"] = valueTemplate;
+
+    JsonObject device = json.createNestedObject("device");
+    device["identifiers"] = deviceId();
+#if AIROCAT_NAMESPACE
+    device["name"] = deviceId();
+#else
+    device["name"] = "Airocat";
+#endif
+    device["model"] = "ESP8266 + BME680 + CCS811";
+    device["manufacturer"] = "Airocat";
+
+#if AIROCAT_NAMESPACE
+    /* The node ID keeps the configs of the devices sharing a broker apart */
+    snprintf(topic, size, "homeassistant/sensor/%s/%s/config", deviceId(), info.key);
+#else
+    snprintf(topic, size, "homeassistant/sensor/airocat/%s/config", info.key);
+#endif
+}
+
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "Metric.hpp"
+
+#if HOMEASSISTANT_INTEGRATE
+
+class Publisher;
+
+/**
+ * Registers all metrics in HomeAssistant as entities of a single device.
+ * The configs are generated from the metric table and published only when the hash
+ * of their content differs from the last published one, which survives reboots in RTC memory.
+ * The configs the publisher has not accepted (e.g. the outbound queue is full) are retried
+ * from loop(), the hash is saved once all of them are accepted.
+ */
+class Discovery {
+public:
+    explicit Discovery(Publisher& publisher);
+
+    void
+    setup();
+
+    /* Republishes the configs when HomeAssistant has announced its restart and continues publishing */
+    void
+    loop();
+
+    /* Publishes the configs if they have changed or if forced to */
+    void
+    publish(bool force = false);
+
+private:
+    [[nodiscard]] uint32_t
+    hash();
+
+    /* Publishes the configs from the next one on while the publisher accepts them */
+    void
+    send();
+
+    void
+    build(Metric metric, JsonDocument& json, char* topic, size_t size);
+
+private:
+    Publisher& _publisher;
+    uint32_t _hash{0};
+    /* The hash of the configs being published and the index of the next one to publish */
+    uint32_t _target{0};
+    uint8_t _next{kMetricCount};
+    bool _pending{false};
+};
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <ArduinoJson.h>
+
+/* The payload encodings selected by AIROCAT_ENCODING */
+#define AIROCAT_ENCODING_JSON 0
+#define AIROCAT_ENCODING_MSGPACK 1
+
+#if HOMEASSISTANT_INTEGRATE && AIROCAT_ENCODING != AIROCAT_ENCODING_JSON
+#error "HomeAssistant integration requires JSON payload encoding"
+#endif
+
+/* Returns the size of the document serialized using selected payload encoding */
+inline size_t
+measure(const JsonDocument& json)
+{
+#if AIROCAT_ENCODING == AIROCAT_ENCODING_MSGPACK
+    return measureMsgPack(json);
+#else
+    return measureJson(json);
+#endif
+}
+
+/* Serializes the document into the output using selected payload encoding, returns the size */
+inline size_t
+encode(const JsonDocument& json, Print& output)
+{
+#if AIROCAT_ENCODING == AIROCAT_ENCODING_MSGPACK
+    return serializeMsgPack(json, output);
+#else
+    return serializeJson(json, output);
+#endif
+}
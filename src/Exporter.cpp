@@ -0,0 +1,174 @@
+#include "Exporter.hpp"
+
+#if AIROCAT_HTTP_PORT
+
+#include <ESP8266WiFi.h>
+
+#include "DataSet.hpp"
+#include "Diagnostics.hpp"
+#include "Log.hpp"
+#include "Sensor1.hpp"
+#include "Sensor2.hpp"
+
+namespace {
+
+WiFiServer server{AIROCAT_HTTP_PORT};
+WiFiClient client;
+
+/* The period to check the connection for new requests */
+constexpr const auto kPollPeriod = UINT32_C(100);
+
+const char kTerminator[] = "\r\n\r\n";
+const char kNotFound[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+
+/* Writes into the fixed buffer, the output beyond its end is dropped */
+class BufferWriter : public Print {
+public:
+    BufferWriter(char* buffer, size_t size)
+        : _buffer{buffer}
+        , _size{size}
+    {
+    }
+
+    size_t
+    write(uint8_t c) override
+    {
+        if (_length == _size) {
+            _overflowed = true;
+            return 0;
+        }
+        _buffer[_length++] = static_cast<char>(c);
+        return 1;
+    }
+
+    [[nodiscard]] size_t
+    length() const
+    {
+        return _length;
+    }
+
+    [[nodiscard]] bool
+    overflowed() const
+    {
+        return _overflowed;
+    }
+
+private:
+    char* _buffer;
+    size_t _size;
+    size_t _length{0};
+    bool _overflowed{false};
+};
+
+} // namespace
+
+Exporter::Exporter(const DataSet& data, const Sensor1& sensor1, const Sensor2& sensor2)
+    : _data{data}
+    , _sensor1{sensor1}
+    , _sensor2{sensor2}
+{
+}
+
+void
+Exporter::setup()
+{
+    server.begin();
+    server.setNoDelay(true);
+}
+
+void
+Exporter::loop()
+{
+    if (server.hasClient()) {
+        /* The new connection replaces the kept-alive one */
+        client.stop();
+        client = server.accept();
+        _requestSize = 0;
+        _terminator = 0;
+    }
+    if (!client || !client.connected()) {
+        return;
+    }
+    receive();
+}
+
+uint32_t
+Exporter::due() const
+{
+    return kPollPeriod;
+}
+
+void
+Exporter::receive()
+{
+    while (client.available() > 0) {
+        const int c = client.read();
+        if (c < 0) {
+            return;
+        }
+        /* The request line and the first headers are enough to answer */
+        if (_requestSize < kRequestSize - 1) {
+            _request[_requestSize++] = static_cast<char>(c);
+            _request[_requestSize] = '\0';
+        }
+        _terminator = (c == kTerminator[_terminator]) ? _terminator + 1 : (c == '\r') ? 1 : 0;
+        if (_terminator == sizeof(kTerminator) - 1) {
+            respond();
+            _requestSize = 0;
+            _terminator = 0;
+            /* Answer a single request per call to not delay the sensors */
+            return;
+        }
+    }
+}
+
+void
+Exporter::respond()
+{
+    Probe probe{Phase::Publish};
+
+    if (strncmp(_request, "GET /metrics ", 13) != 0 && strncmp(_request, "GET /metrics?", 13) != 0) {
+        client.write(reinterpret_cast<const uint8_t*>(kNotFound), sizeof(kNotFound) - 1);
+    } else {
+        if (!_rendered || _version != _data.version()) {
+            render();
+        }
+        client.write(reinterpret_cast<const uint8_t*>(_response + _responseBegin),
+                     _responseEnd - _responseBegin);
+    }
+
+    /* The connection is kept alive unless the client asks to close it (the header names and
+       values are matched without the first letter to not care about its case) */
+    const bool close = (strstr(_request, "HTTP/1.0") != nullptr && strstr(_request, "eep-alive") == nullptr)
+                       || strstr(_request, "onnection: close") != nullptr;
+    if (close) {
+        client.stop();
+    }
+}
+
+void
+Exporter::render()
+{
+    /* The body is rendered after the space reserved for header, the header is put right before it */
+    BufferWriter body{_response + kHeaderSize, kResponseSize - kHeaderSize};
+    _sensor1.expose(body);
+    _sensor2.expose(body);
+    if (body.overflowed()) {
+        LOG_WARNING("Exporter: Response is truncated");
+    }
+
+    char header[kHeaderSize];
+    const auto length = static_cast<size_t>(snprintf(header,
+                                                     sizeof(header),
+                                                     "HTTP/1.1 200 OK\r\n"
+                                                     "Content-Type: text/plain; version=0.0.4\r\n"
+                                                     "Content-Length: %u\r\n\r\n",
+                                                     static_cast<unsigned>(body.length())));
+    _responseBegin = kHeaderSize - std::min(length, kHeaderSize - 1);
+    memcpy(_response + _responseBegin, header, kHeaderSize - _responseBegin);
+    _responseEnd = kHeaderSize + body.length();
+    _version = _data.version();
+    _rendered = true;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <Arduino.h>
+
+#if AIROCAT_HTTP_PORT
+
+class DataSet;
+class Sensor1;
+class Sensor2;
+
+/**
+ * Serves the current values on /metrics in Prometheus text exposition format over HTTP.
+ * The response is rendered into a fixed buffer only when any value has changed since
+ * the previous scrape, and is written to the connection with a single call. A single
+ * kept-alive connection is served at a time, a new connection replaces it.
+ */
+class Exporter {
+public:
+    Exporter(const DataSet& data, const Sensor1& sensor1, const Sensor2& sensor2);
+
+    void
+    setup();
+
+    /* Accepts the connection and answers a single request per call */
+    void
+    loop();
+
+    /* Returns the number of milliseconds till the next check of the connection */
+    [[nodiscard]] uint32_t
+    due() const;
+
+private:
+    void
+    receive();
+
+    void
+    respond();
+
+    void
+    render();
+
+private:
+    static constexpr size_t kRequestSize = 128;
+    static constexpr size_t kHeaderSize = 96;
+    static constexpr size_t kResponseSize = 2048;
+
+    const DataSet& _data;
+    const Sensor1& _sensor1;
+    const Sensor2& _sensor2;
+    char _request[kRequestSize]{};
+    size_t _requestSize{0};
+    /* The number of bytes of the request header end sequence matched so far */
+    uint8_t _terminator{0};
+    char _response[kResponseSize]{};
+    size_t _responseBegin{0};
+    size_t _responseEnd{0};
+    uint32_t _version{0};
+    bool _rendered{false};
+};
+
+#endif
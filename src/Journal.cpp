@@ -0,0 +1,91 @@
+#include "Journal.hpp"
+
+#include <LittleFS.h>
+#include <coredecls.h>
+
+#include "Log.hpp"
+
+namespace {
+
+constexpr const auto kMagic = UINT32_C(0x4C4E524A);
+
+} // namespace
+
+Journal::Journal(const char* prefix)
+    : _prefix{prefix}
+{
+}
+
+bool
+Journal::setup()
+{
+    if (!LittleFS.begin()) {
+        LOG_ERROR("Journal: Unable to mount filesystem");
+        return false;
+    }
+    return true;
+}
+
+bool
+Journal::load(uint8_t* data, size_t size)
+{
+    Header header{};
+    bool found{false};
+    for (uint8_t slot = 0; slot < kSlots; ++slot) {
+        if (read(slot, header, data, size) && (!found || header.sequence > _sequence)) {
+            found = true;
+            _sequence = header.sequence;
+            _slot = slot;
+        }
+    }
+    /* The data of the last checked slot is in the buffer, read the newest one again */
+    return found && read(_slot, header, data, size);
+}
+
+bool
+Journal::save(const uint8_t* data, size_t size)
+{
+    const uint8_t slot = (_slot + 1) % kSlots;
+    char name[32];
+    path(slot, name, sizeof(name));
+
+    const Header header{kMagic, _sequence + 1, static_cast<uint32_t>(size), crc32(data, size)};
+    File file = LittleFS.open(name, "w");
+    if (!file) {
+        return false;
+    }
+    const auto written = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header))
+                         + file.write(data, size);
+    file.close();
+    if (written != sizeof(header) + size) {
+        return false;
+    }
+    _sequence = header.sequence;
+    _slot = slot;
+    return true;
+}
+
+void
+Journal::path(uint8_t slot, char* buffer, size_t size) const
+{
+    snprintf(buffer, size, "%s%u.bin", _prefix, slot);
+}
+
+bool
+Journal::read(uint8_t slot, Header& header, uint8_t* data, size_t size) const
+{
+    char name[32];
+    path(slot, name, sizeof(name));
+    if (!LittleFS.exists(name)) {
+        return false;
+    }
+    File file = LittleFS.open(name, "r");
+    if (!file) {
+        return false;
+    }
+    if (file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header)
+        || header.magic != kMagic || header.size != size) {
+        return false;
+    }
+    return (file.read(data, size) == size) && (header.crc == crc32(data, size));
+}
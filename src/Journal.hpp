@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Keeps copies of a binary record in LittleFS. Every save goes in a single bulk write to
+ * the slot file not holding the newest copy, so a power loss in the middle of save leaves
+ * the previous copy intact and the writes rotate over the slots. Every copy is guarded by CRC
+ * and sequence number, the load picks the newest valid one.
+ */
+class Journal {
+public:
+    /* The path prefix of slot files, the slot number is appended to it */
+    explicit Journal(const char* prefix);
+
+    [[nodiscard]] bool
+    setup();
+
+    /* Reads the newest valid copy of the record, returns false if there is none */
+    [[nodiscard]] bool
+    load(uint8_t* data, size_t size);
+
+    [[nodiscard]] bool
+    save(const uint8_t* data, size_t size);
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t size;
+        uint32_t crc;
+    };
+
+    static constexpr uint8_t kSlots = 2;
+
+    void
+    path(uint8_t slot, char* buffer, size_t size) const;
+
+    bool
+    read(uint8_t slot, Header& header, uint8_t* data, size_t size) const;
+
+private:
+    const char* _prefix;
+    uint32_t _sequence{0};
+    uint8_t _slot{kSlots - 1};
+};
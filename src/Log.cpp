@@ -0,0 +1,241 @@
+#include "Log.hpp"
+
+#include <stdarg.h>
+
+#include <algorithm>
+
+#if AIROCAT_LOG_MQTT
+#include <ArduinoJson.h>
+
+#include "Device.hpp"
+#include "Publisher.hpp"
+#endif
+
+namespace {
+
+/* The buffer of messages waiting for the serial FIFO (~1 s of output at 9600 baud) */
+constexpr const auto kRingSize = size_t{1024};
+/* The longest message, the longer ones are truncated */
+constexpr const auto kLineMax = size_t{128};
+/* The period to refill the FIFO, its 128 bytes take ~130 ms at 9600 baud */
+constexpr const auto kDrainPeriod = UINT32_C(20);
+/* The window to count the repeats of the same message in */
+constexpr const auto kRepeatWindow = UINT32_C(60 * 1000);
+
+/* The level tags prepended to the messages */
+const char kLevelTags[] = {' ', 'E', 'W', 'I', 'D'};
+
+char Ring[kRingSize];
+size_t Head{0};
+size_t Size{0};
+uint32_t Dropped{0};
+
+/* The last message written and the number of its repeats since then */
+struct {
+    uint32_t hash;
+    uint32_t timestamp;
+    uint32_t repeats;
+    uint8_t level;
+} Last{};
+
+#if AIROCAT_LOG_MQTT
+/* The messages waiting to be published, the oldest are dropped when it is full */
+constexpr const uint8_t kSinkLines = 4;
+/* The topic name under the device prefix (see deviceTopic()) */
+const char* kTopicName = "log";
+const char* kLevelNames[] = {"", "error", "warning", "info", "debug"};
+
+struct SinkLine {
+    uint32_t timestamp;
+    uint8_t level;
+    char text[96];
+};
+
+SinkLine Sink[kSinkLines];
+uint8_t SinkHead{0};
+uint8_t SinkCount{0};
+
+void
+sink(uint8_t level, const char* text)
+{
+    if (level > AIROCAT_LOG_MQTT) {
+        return;
+    }
+    if (SinkCount == kSinkLines) {
+        SinkHead = (SinkHead + 1) % kSinkLines;
+        SinkCount--;
+    }
+    SinkLine& line = Sink[(SinkHead + SinkCount++) % kSinkLines];
+    line.timestamp = millis();
+    line.level = level;
+    strncpy(line.text, text, sizeof(line.text) - 1);
+    line.text[sizeof(line.text) - 1] = '\0';
+}
+#endif
+
+uint32_t
+hash(const char* text)
+{
+    uint32_t value{UINT32_C(2166136261)};
+    while (*text != '\0') {
+        value = (value ^ static_cast<uint8_t>(*text++)) * UINT32_C(16777619);
+    }
+    return value;
+}
+
+/* Appends the text to the ring as a whole or not at all */
+bool
+push(const char* text, size_t length)
+{
+    if (Size + length > kRingSize) {
+        return false;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        Ring[(Head + Size++) % kRingSize] = text[i];
+    }
+    return true;
+}
+
+void
+emit(char tag, const char* text)
+{
+    char line[kLineMax + 8];
+    if (Dropped > 0) {
+        const auto length
+            = snprintf(line, sizeof(line), "[W] (%u messages dropped)\r\n", static_cast<unsigned>(Dropped));
+        if (!push(line, length)) {
+            Dropped++;
+            return;
+        }
+        Dropped = 0;
+    }
+    const auto length = (tag == '\0') ? snprintf(line, sizeof(line), "%s\r\n", text)
+                                      : snprintf(line, sizeof(line), "[%c] %s\r\n", tag, text);
+    if (!push(line, std::min(static_cast<size_t>(length), sizeof(line) - 1))) {
+        Dropped++;
+    }
+}
+
+/* Moves the whole buffer into the serial port, waiting for the FIFO */
+void
+flush()
+{
+    while (Size > 0) {
+        const auto chunk = std::min(Size, kRingSize - Head);
+        Serial.write(reinterpret_cast<const uint8_t*>(Ring + Head), chunk);
+        Head = (Head + chunk) % kRingSize;
+        Size -= chunk;
+    }
+}
+
+/* Writes the number of repeats of the last message if there were any */
+void
+flushRepeats()
+{
+    if (Last.repeats == 0) {
+        return;
+    }
+    char text[32];
+    snprintf(text, sizeof(text), "(repeated %u times)", static_cast<unsigned>(Last.repeats));
+    emit(kLevelTags[Last.level], text);
+    Last.repeats = 0;
+}
+
+} // namespace
+
+void
+logWrite(uint8_t level, const char* format, ...)
+{
+    char text[kLineMax];
+    va_list args;
+    va_start(args, format);
+    vsnprintf_P(text, sizeof(text), format, args);
+    va_end(args);
+
+    const auto textHash = hash(text);
+    const auto now = millis();
+    if (textHash == Last.hash && now - Last.timestamp < kRepeatWindow) {
+        Last.repeats++;
+        return;
+    }
+    flushRepeats();
+    Last.hash = textHash;
+    Last.timestamp = now;
+    Last.level = level;
+
+    emit(kLevelTags[level], text);
+#if AIROCAT_LOG_MQTT
+    sink(level, text);
+#endif
+}
+
+void
+logLine(const char* line)
+{
+    /* The records must not be lost, so wait for the serial FIFO instead of dropping */
+    if (Size + 2 * kLineMax > kRingSize) {
+        /* Makes room for the line and the dropped messages mark */
+        flush();
+    }
+    emit('\0', line);
+}
+
+void
+logLoop()
+{
+    if (Last.repeats > 0 && millis() - Last.timestamp >= kRepeatWindow) {
+        flushRepeats();
+        /* The next occurrence is written and starts counting again */
+        Last.hash = 0;
+    }
+
+    auto room = static_cast<size_t>(std::max(Serial.availableForWrite(), 0));
+    while (room > 0 && Size > 0) {
+        const auto chunk = std::min({room, Size, kRingSize - Head});
+        Serial.write(reinterpret_cast<const uint8_t*>(Ring + Head), chunk);
+        Head = (Head + chunk) % kRingSize;
+        Size -= chunk;
+        room -= chunk;
+    }
+}
+
+uint32_t
+logDue()
+{
+    if (Size > 0) {
+        return kDrainPeriod;
+    }
+    if (Last.repeats > 0) {
+        const auto elapsed = millis() - Last.timestamp;
+        return (elapsed < kRepeatWindow) ? kRepeatWindow - elapsed : 0;
+    }
+    return UINT32_MAX;
+}
+
+#if AIROCAT_LOG_MQTT
+void
+logPublish(Publisher& publisher)
+{
+    static StaticJsonDocument<JSON_OBJECT_SIZE(3)> json;
+
+    if (SinkCount == 0 || !publisher.connected()) {
+        return;
+    }
+    char topic[64];
+    deviceTopic(kTopicName, topic, sizeof(topic));
+    while (SinkCount > 0) {
+        /* The line is taken out first as the publish might log */
+        const SinkLine line = Sink[SinkHead];
+        SinkHead = (SinkHead + 1) % kSinkLines;
+        SinkCount--;
+
+        json.clear();
+        json["level"] = kLevelNames[line.level];
+        json["uptime"] = line.timestamp;
+        json["message"] = line.text;
+        if (!publisher.publish(topic, json, false)) {
+            break;
+        }
+    }
+}
+#endif
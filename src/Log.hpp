@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+
+/* The log levels selected by AIROCAT_LOG_LEVEL, the messages above it are not compiled in */
+#define AIROCAT_LOG_NONE 0
+#define AIROCAT_LOG_ERROR 1
+#define AIROCAT_LOG_WARNING 2
+#define AIROCAT_LOG_INFO 3
+#define AIROCAT_LOG_DEBUG 4
+
+class Publisher;
+
+/**
+ * Formats the message into the ring buffer which is moved into the serial FIFO as it frees up,
+ * so logging never waits for the UART (a line takes ~40 ms at 9600 baud). The message which does
+ * not fit the buffer is dropped and counted. The repeats of the same message within a minute are
+ * counted instead of written, the count follows once another message comes or the minute is over.
+ * The format is kept in flash, use the LOG_* macros instead of calling it directly.
+ */
+void
+logWrite(uint8_t level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/* Writes the line as is bypassing the levels and the repeat counting, it waits instead of dropping */
+void
+logLine(const char* line);
+
+/* Moves the buffered messages into the serial FIFO while it has room */
+void
+logLoop();
+
+/* Returns the number of milliseconds till the buffered messages need to be moved again */
+[[nodiscard]] uint32_t
+logDue();
+
+#if AIROCAT_LOG_MQTT
+/* Publishes the messages up to AIROCAT_LOG_MQTT level to the log topic (see deviceTopic()) */
+void
+logPublish(Publisher& publisher);
+#endif
+
+/* The stripped message is still checked and uses its arguments, but is compiled out as dead code */
+#define AIROCAT_LOG_STRIPPED(format, ...) (false ? logWrite(0, PSTR(format), ##__VA_ARGS__) : (void) 0)
+
+#if AIROCAT_LOG_LEVEL >= AIROCAT_LOG_ERROR
+#define LOG_ERROR(format, ...) logWrite(AIROCAT_LOG_ERROR, PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...) AIROCAT_LOG_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#if AIROCAT_LOG_LEVEL >= AIROCAT_LOG_WARNING
+#define LOG_WARNING(format, ...) logWrite(AIROCAT_LOG_WARNING, PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_WARNING(format, ...) AIROCAT_LOG_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#if AIROCAT_LOG_LEVEL >= AIROCAT_LOG_INFO
+#define LOG_INFO(format, ...) logWrite(AIROCAT_LOG_INFO, PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) AIROCAT_LOG_STRIPPED(format, ##__VA_ARGS__)
+#endif
+
+#if AIROCAT_LOG_LEVEL >= AIROCAT_LOG_DEBUG
+#define LOG_DEBUG(format, ...) logWrite(AIROCAT_LOG_DEBUG, PSTR(format), ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) AIROCAT_LOG_STRIPPED(format, ##__VA_ARGS__)
+#endif
@@ -0,0 +1,80 @@
+#include "Metric.hpp"
+
+#include "Device.hpp"
+
+namespace {
+
+/* The prefix of the Prometheus metric names */
+const char* kNamePrefix = "airocat";
+
+/**
+ * The stabilization statuses are published on any change, other metrics ignore the noise of last digits.
+ * The events are tripped by the sudden rises of air quality metrics (see AIROCAT_EVENTS).
+ */
+const MetricInfo kMetrics[kMetricCount] PROGMEM = {
+    /* key, caption, unit, device class, precision, gated, initial, absolute, relative, deviation, slope */
+    {"iaq", "IAQ", "", "aqi", 1, true, 0.f, 1.f, 0.f, 50.f, 25.f},
+    {"co2Eq", "CO2 (equivalent)", "", "", 1, true, 0.f, 5.f, 0.01f, 200.f, 100.f},
+    {"breathVocEq", "BreathVoc (equivalent)", "", "", 1, false, 0.f, 0.01f, 0.02f, 0.f, 0.f},
+    {"temperature", "Temperature, °C", "C", "temperature", 1, false, 0.f, 0.1f, 0.f, 0.f, 0.f},
+    {"humidity", "Humidity, %", "%", "humidity", 1, false, 0.f, 0.5f, 0.f, 0.f, 0.f},
+    {"pressure", "Pressure, hPa", "hPa", "pressure", 1, false, 0.f, 0.f, 0.0001f, 0.f, 0.f},
+    {"gasResistance", "Gar (resistance), Ohm", "Ohm", "", 1, false, 0.f, 0.f, 0.02f, 0.f, 0.f},
+    {"gasPercentage", "Gar (percentage), %", "%", "", 1, false, 0.f, 1.f, 0.f, 0.f, 0.f},
+    {"initialStabStatus", "Initial stabilization status", "", "", 0, false, -1.f, 0.f, 0.f, 0.f, 0.f},
+    {"powerOnStabStatus", "Power-on stabilization status", "", "", 0, false, -1.f, 0.f, 0.f, 0.f, 0.f},
+    {"co2", "CO2, ppm", "ppm", "carbon_dioxide", 0, false, 0.f, 10.f, 0.f, 300.f, 150.f},
+    {"tvoc", "TVOC, ppb", "ppb", "volatile_organic_compounds_parts", 0, false, 0.f, 3.f, 0.f, 100.f, 50.f},
+};
+
+} // namespace
+
+MetricInfo
+metricInfo(Metric metric)
+{
+    MetricInfo info;
+    memcpy_P(&info, &kMetrics[static_cast<uint8_t>(metric)], sizeof(MetricInfo));
+    return info;
+}
+
+void
+metricKey(Metric metric, char (&key)[sizeof(MetricInfo::key)])
+{
+    strncpy_P(key, kMetrics[static_cast<uint8_t>(metric)].key, sizeof(key));
+}
+
+bool
+metricFind(const char* key, Metric& metric)
+{
+    for (uint8_t index = 0; index < kMetricCount; ++index) {
+        if (strcmp_P(key, kMetrics[index].key) == 0) {
+            metric = static_cast<Metric>(index);
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+metricTopic(Metric metric, char* topic, size_t size)
+{
+    /* The key is copied out of flash as %s reads the argument byte by byte */
+    char key[sizeof(MetricInfo::key)];
+    metricKey(metric, key);
+    deviceTopic(key, topic, size);
+}
+
+void
+metricName(Metric metric, char* name, size_t size)
+{
+    char key[sizeof(MetricInfo::key)];
+    metricKey(metric, key);
+    size_t length = snprintf_P(name, size, PSTR("%s_"), kNamePrefix);
+    for (const char* c = key; *c != '\0' && length + 2 < size; ++c) {
+        if (isupper(*c)) {
+            name[length++] = '_';
+        }
+        name[length++] = static_cast<char>(tolower(*c));
+    }
+    name[std::min(length, size - 1)] = '\0';
+}
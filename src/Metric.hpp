@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+
+/* The identifiers of metrics used in compact payloads (keep in sync with tools/airocat.py) */
+enum class Metric : uint8_t {
+    Iaq = 0,
+    Co2Eq,
+    BreathVocEq,
+    Temperature,
+    Humidity,
+    Pressure,
+    GasResistance,
+    GasPercentage,
+    InitialStabStatus,
+    PowerOnStabStatus,
+    Co2,
+    Tvoc,
+    Count,
+};
+
+/* The number of metrics */
+constexpr auto kMetricCount = static_cast<uint8_t>(Metric::Count);
+
+/* The static description of metric, the table of descriptions is kept in flash */
+struct MetricInfo {
+    /* The last segment of topic and the key in aggregated payloads */
+    char key[20];
+    char caption[32];
+    char unit[8];
+    /* The HomeAssistant device class (empty if none) */
+    char deviceClass[34];
+    /* The number of decimal digits to publish */
+    uint8_t precision;
+    /* Publish only after the sensor stabilization */
+    bool gated;
+    float initial;
+    /* The default absolute and relative deadband */
+    float absolute;
+    float relative;
+    /* The default event thresholds: deviation from the average and rate of change per minute (0 - none) */
+    float deviation;
+    float slope;
+};
+
+/* Reads the description of the metric from flash */
+[[nodiscard]] MetricInfo
+metricInfo(Metric metric);
+
+/* Reads the key of the metric from flash into the buffer */
+void
+metricKey(Metric metric, char (&key)[sizeof(MetricInfo::key)]);
+
+/* Finds the metric by its key, returns false if there is no such metric */
+[[nodiscard]] bool
+metricFind(const char* key, Metric& metric);
+
+/* Formats the MQTT topic to publish the metric values to */
+void
+metricTopic(Metric metric, char* topic, size_t size);
+
+/* Formats the Prometheus metric name (the key in snake case with prefix) */
+void
+metricName(Metric metric, char* name, size_t size);
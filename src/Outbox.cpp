@@ -0,0 +1,124 @@
+#include "Outbox.hpp"
+
+#if AIROCAT_QUEUE
+
+#include "Encoding.hpp"
+
+namespace {
+
+/* Writes the serializer output into the reserved part of the queue */
+class SliceWriter : public Print {
+public:
+    SliceWriter(uint8_t* buffer, size_t size)
+        : _buffer{buffer}
+        , _size{size}
+    {
+    }
+
+    size_t
+    write(uint8_t c) override
+    {
+        if (_length == _size) {
+            return 0;
+        }
+        _buffer[_length++] = c;
+        return 1;
+    }
+
+private:
+    uint8_t* _buffer;
+    size_t _size;
+    size_t _length{0};
+};
+
+} // namespace
+
+bool
+Outbox::push(const char* topic, const JsonDocument& json, bool retained)
+{
+    const Header header{static_cast<uint16_t>(strlen(topic)), static_cast<uint16_t>(measure(json)), retained};
+    const auto size = entrySize(header);
+    if (_size + size > sizeof(_buffer)) {
+        _rejected++;
+        return false;
+    }
+
+    uint8_t* entry = _buffer + _size;
+    memcpy(entry, &header, sizeof(header));
+    memcpy(entry + sizeof(header), topic, header.topicLength + 1);
+    SliceWriter writer{entry + sizeof(header) + header.topicLength + 1, header.payloadLength};
+    encode(json, writer);
+
+    _size += size;
+    _count++;
+    _peak = std::max(_peak, _size);
+    return true;
+}
+
+bool
+Outbox::front(Message& message) const
+{
+    if (empty()) {
+        return false;
+    }
+    Header header;
+    memcpy(&header, _buffer, sizeof(header));
+    message.topic = reinterpret_cast<const char*>(_buffer + sizeof(header));
+    message.payload = _buffer + sizeof(header) + header.topicLength + 1;
+    message.length = header.payloadLength;
+    message.retained = header.retained;
+    return true;
+}
+
+void
+Outbox::pop()
+{
+    if (empty()) {
+        return;
+    }
+    Header header;
+    memcpy(&header, _buffer, sizeof(header));
+    const auto size = entrySize(header);
+    /* The queue is small and shifted once per sent message, which keeps the entries contiguous */
+    memmove(_buffer, _buffer + size, _size - size);
+    _size -= size;
+    _count--;
+}
+
+bool
+Outbox::empty() const
+{
+    return (_count == 0);
+}
+
+size_t
+Outbox::count() const
+{
+    return _count;
+}
+
+size_t
+Outbox::size() const
+{
+    return _size;
+}
+
+size_t
+Outbox::peak() const
+{
+    return _peak;
+}
+
+uint32_t
+Outbox::rejected() const
+{
+    return _rejected;
+}
+
+size_t
+Outbox::entrySize(const Header& header)
+{
+    return sizeof(header) + header.topicLength + 1 + header.payloadLength;
+}
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#if AIROCAT_QUEUE
+/**
+ * Bounded queue of serialized outbound messages. The publishers push the messages without
+ * waiting for the network, the connection takes them out oldest first while the TCP send buffer
+ * has room. When the queue is full, the new message is rejected, so the accepted ones are never lost
+ * and the publisher reports the failure to the caller (which keeps the value in the backlog).
+ */
+class Outbox {
+public:
+    struct Message {
+        const char* topic;
+        const uint8_t* payload;
+        size_t length;
+        bool retained;
+    };
+
+    Outbox() = default;
+
+    /* Serializes the document into the queue, returns false if it does not fit into the free space */
+    [[nodiscard]] bool
+    push(const char* topic, const JsonDocument& json, bool retained);
+
+    /* Returns the oldest message, it stays valid until pop() or push() */
+    [[nodiscard]] bool
+    front(Message& message) const;
+
+    /* Removes the oldest message */
+    void
+    pop();
+
+    [[nodiscard]] bool
+    empty() const;
+
+    /* Returns the number of queued messages */
+    [[nodiscard]] size_t
+    count() const;
+
+    /* Returns the number of queued bytes */
+    [[nodiscard]] size_t
+    size() const;
+
+    /* Returns the maximum number of queued bytes since boot */
+    [[nodiscard]] size_t
+    peak() const;
+
+    /* Returns the number of messages rejected because of overflow since boot */
+    [[nodiscard]] uint32_t
+    rejected() const;
+
+private:
+    struct Header {
+        uint16_t topicLength;
+        uint16_t payloadLength;
+        bool retained;
+    };
+
+    [[nodiscard]] static size_t
+    entrySize(const Header& header);
+
+private:
+    /* The entries (header, zero terminated topic, payload) are kept contiguous from the start */
+    uint8_t _buffer[AIROCAT_QUEUE];
+    size_t _size{0};
+    size_t _count{0};
+    size_t _peak{0};
+    uint32_t _rejected{0};
+};
+#endif
@@ -3,59 +3,533 @@
 #include <ESP8266WiFi.h>
 #include <PubSubClient.h>
 
-static WiFiClient wifiClient;
-static PubSubClient mqttClient{wifiClient};
+#include "Device.hpp"
+#include "Diagnostics.hpp"
+#include "Encoding.hpp"
+#include "Log.hpp"
+#include "Rtc.hpp"
+#include "Stamp.hpp"
+
+namespace {
+
+WiFiClient wifiClient;
+PubSubClient mqttClient{wifiClient};
+
+/* The time to wait for association with WiFi access point */
+constexpr const auto kWifiConnectTimeout = UINT32_C(15 * 1000);
+/**
+ * The timeouts of single TCP connect attempt (ms) and of waiting for MQTT response (s, the shortest
+ * PubSubClient supports). The connect blocks the loop, so a failed attempt takes at most 1.5 s once
+ * per backoff delay, the BSEC sample due meanwhile is taken late (see Sensor1::read()).
+ */
+constexpr const auto kTcpConnectTimeout = UINT32_C(500);
+constexpr const auto kMqttResponseTimeout = UINT16_C(1);
+/* The backoff delay range between failed connection attempts */
+constexpr const auto kBackoffMin = UINT32_C(1000);
+constexpr const auto kBackoffMax = UINT32_C(60 * 1000);
+/* The period to check the connection status and incoming messages */
+constexpr const auto kPollPeriod = UINT32_C(100);
+/* The number of DTIM beacons the radio sleeps through between wakeups (1..10) */
+constexpr const auto kWifiListenInterval = UINT8_C(3);
+
+#if AIROCAT_FAST_CONNECT
+/* The time to wait for association with cached access point before falling back to scan */
+constexpr const auto kFastConnectTimeout = UINT32_C(3 * 1000);
+/* The number of connects with cached IP lease before asking DHCP again to renew it */
+constexpr const auto kLeaseUsesMax = UINT16_C(32);
+
+/* The access point and IP lease of the last connection */
+struct WifiLease {
+    uint8_t bssid[6];
+    uint16_t uses;
+    uint32_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+WifiLease Lease{};
+static_assert(rtcFits<WifiLease>(RtcSlot::Wifi, RtcSlot::Values), "The lease overlaps the next RTC slot");
+#endif
+
+#if AIROCAT_QUEUE
+/* The period to retry flushing while the TCP send buffer waits for ACKs */
+constexpr const auto kFlushPeriod = UINT32_C(10);
+/* The TCP segment size, the larger messages are written once a full segment fits */
+constexpr const auto kSegmentSize = size_t{1460};
+/* The maximum size of MQTT fixed header (type byte and 4 bytes of remaining length) */
+constexpr const auto kHeaderSizeMax = size_t{5};
+#endif
+
+#if AIROCAT_BACKLOG
+/* The topic name to publish buffered samples to */
+const char* kBacklogTopicName = "backlog";
+/* The maximum number of buffered samples in single message */
+constexpr const auto kDrainBatch = size_t{12};
+/* The minimal period between two messages with buffered samples */
+constexpr const auto kDrainPeriod = UINT32_C(500);
+#endif
+
+#if !AIROCAT_QUEUE
+/**
+ * Collects the small writes of serializer into chunks to not pass
+ * every single byte of payload down to the TCP stack.
+ */
+class ChunkWriter : public Print {
+public:
+    explicit ChunkWriter(Print& output)
+        : _output{output}
+    {
+    }
+
+    size_t
+    write(uint8_t c) override
+    {
+        if (_size == sizeof(_chunk)) {
+            flush();
+        }
+        _chunk[_size++] = c;
+        return 1;
+    }
+
+    size_t
+    write(const uint8_t* data, size_t size) override
+    {
+        for (size_t i = 0; i < size; ++i) {
+            write(data[i]);
+        }
+        return size;
+    }
+
+    void
+    flush() override
+    {
+        if (_size > 0) {
+            _output.write(_chunk, _size);
+            _size = 0;
+        }
+    }
+
+private:
+    Print& _output;
+    uint8_t _chunk[64];
+    size_t _size{0};
+};
+
+bool
+stream(const char* topic, const JsonDocument& json, bool retained)
+{
+    if (!mqttClient.beginPublish(topic, measure(json), retained)) {
+        return false;
+    }
+    ChunkWriter writer{mqttClient};
+    encode(json, writer);
+    writer.flush();
+    return (mqttClient.endPublish() == 1);
+}
+#else
+/* Returns the size of MQTT PUBLISH packet (QoS 0) with given topic and payload */
+size_t
+frameSize(size_t topicLength, size_t payloadLength)
+{
+    size_t remaining = 2 + topicLength + payloadLength;
+    size_t header = 1;
+    do {
+        header++;
+        remaining >>= 7;
+    } while (remaining > 0);
+    return header + 2 + topicLength + payloadLength;
+}
+
+bool
+send(const Outbox::Message& message)
+{
+    /* The packet assembled in the client buffer leaves in a single write, i.e. a single segment with NODELAY */
+    if (kHeaderSizeMax + 2 + strlen(message.topic) + message.length <= mqttClient.getBufferSize()) {
+        return mqttClient.publish(message.topic, message.payload, message.length, message.retained);
+    }
+    if (!mqttClient.beginPublish(message.topic, message.length, message.retained)) {
+        return false;
+    }
+    mqttClient.write(message.payload, message.length);
+    return (mqttClient.endPublish() == 1);
+}
+#endif
+
+} // namespace
 
 bool
 Publisher::connected() const
 {
-    return mqttClient.connected();
+    return (_state == State::Connected) && mqttClient.connected();
+}
+
+Publisher::State
+Publisher::state() const
+{
+    return _state;
 }
 
 void
 Publisher::setup()
 {
-    Serial.println();
-    Serial.print("Connecting to WiFi: ");
-    Serial.println(WIFI_SSID);
-
+#if AIROCAT_FAST_CONNECT
+    /* The cache in RTC memory replaces the SDK config, so skip writing it to flash on every begin() */
+    WiFi.persistent(false);
+    _fastConnect = rtcLoad(RtcSlot::Wifi, Lease) && Lease.channel != 0;
+#endif
     WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID, WIFI_PASS);
-    while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
-    }
-
-    Serial.println();
-    Serial.println("WiFi connected");
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());
+    WiFi.setAutoReconnect(true);
+    /* The radio is powered down between beacons and woken up by the stack to transmit */
+    WiFi.setSleepMode(static_cast<WiFiSleepType_t>(AIROCAT_WIFI_SLEEP),
+                      (AIROCAT_WIFI_SLEEP == WIFI_NONE_SLEEP) ? 0 : kWifiListenInterval);
 
+    wifiClient.setTimeout(kTcpConnectTimeout);
+    mqttClient.setSocketTimeout(kMqttResponseTimeout);
     mqttClient.setBufferSize(MQTT_MAX_PACKET_SIZE * 2);
     mqttClient.setServer(MQTT_HOST, MQTT_PORT);
+    mqttClient.setCallback([this](char* topic, uint8_t* payload, unsigned int length) {
+        dispatch(topic, payload, length);
+    });
+
+#if AIROCAT_BACKLOG
+    _backlog.setup();
+#endif
+
+    enter(State::WifiDown);
+}
+
+bool
+Publisher::loop()
+{
+    if (millis() - _timestamp < _delay) {
+        return false;
+    }
+
+    Probe probe{Phase::Connect};
+
+    switch (_state) {
+    case State::WifiDown:
+        connectWifi();
+        break;
+    case State::WifiConnecting:
+        waitWifi();
+        break;
+    case State::MqttConnecting:
+        return connectMqtt();
+    case State::Connected:
+        checkConnection();
+        break;
+    }
+    return false;
+}
+
+uint32_t
+Publisher::due() const
+{
+    const auto elapsed = millis() - _timestamp;
+    if (elapsed < _delay) {
+        return _delay - elapsed;
+    }
+
+    switch (_state) {
+    case State::WifiConnecting:
+        return kPollPeriod;
+    case State::Connected:
+#if AIROCAT_QUEUE
+        if (!_outbox.empty()) {
+            return kFlushPeriod;
+        }
+#endif
+#if AIROCAT_BACKLOG
+        if (!_backlog.empty()) {
+            const auto drainElapsed = millis() - _drainTimestamp;
+            return (drainElapsed < kDrainPeriod) ? std::min(kDrainPeriod - drainElapsed, kPollPeriod) : 0;
+        }
+#endif
+        return kPollPeriod;
+    default:
+        return 0;
+    }
+}
+
+void
+Publisher::subscribe(const char* topic, Handler handler)
+{
+    if (_subscriptionsCount == kSubscriptionsMax) {
+        LOG_ERROR("Unable to subscribe: %s", topic);
+        return;
+    }
+    _subscriptions[_subscriptionsCount++] = Subscription{topic, std::move(handler)};
+    if (connected()) {
+        mqttClient.subscribe(topic);
+    }
+}
+
+bool
+Publisher::publish(const char* topic, const JsonDocument& json, bool retained)
+{
+    if (!connected()) {
+        return false;
+    }
+#if AIROCAT_QUEUE
+    if (!_outbox.push(topic, json, retained)) {
+        return false;
+    }
+    flush();
+    return true;
+#else
+    return stream(topic, json, retained);
+#endif
+}
+
+#if AIROCAT_BACKLOG
+Backlog&
+Publisher::backlog()
+{
+    return _backlog;
+}
+#endif
+
+#if AIROCAT_QUEUE
+const Outbox&
+Publisher::outbox() const
+{
+    return _outbox;
+}
+#endif
+
+void
+Publisher::enter(State state, uint32_t delay)
+{
+    _state = state;
+    _timestamp = millis();
+    _delay = delay;
 }
 
 void
-Publisher::connect()
+Publisher::retry(State state)
 {
-    while (!mqttClient.connected()) {
-        Serial.print("Connecting to MQTT: ");
-        Serial.println(MQTT_HOST);
-        String clientId = "airocat-";
-        clientId += String(random(0xffff), HEX);
-        if (mqttClient.connect(clientId.c_str(), MQTT_USER, MQTT_PASS)) {
-            Serial.println("MQTT connected");
+    /* Exponential backoff with jitter to spread reconnects of many devices after broker restart */
+    const auto exponent = std::min<uint8_t>(_attempts, 6);
+    const auto backoff = std::min(kBackoffMin << exponent, kBackoffMax);
+    if (_attempts < UINT8_MAX) {
+        _attempts++;
+    }
+    const auto delay = backoff / 2 + random(backoff / 2 + 1);
+    LOG_DEBUG("Try again in %lu ms", static_cast<unsigned long>(delay));
+    enter(state, delay);
+}
+
+void
+Publisher::connectWifi()
+{
+#if AIROCAT_FAST_CONNECT
+    if (_fastConnect) {
+        LOG_INFO("Connecting to WiFi (cached): %s", WIFI_SSID);
+        /* The lease is reused for a limited number of connects to not keep the address the DHCP server gave away */
+        if (Lease.uses < kLeaseUsesMax) {
+            WiFi.config(IPAddress{Lease.ip}, IPAddress{Lease.gateway}, IPAddress{Lease.subnet}, IPAddress{Lease.dns});
         } else {
-            Serial.print("MQTT connecting failed, rc=");
-            Serial.print(mqttClient.state());
-            Serial.println(" try again in 5 seconds");
-            delay(5000);
+            WiFi.config(IPAddress{}, IPAddress{}, IPAddress{});
         }
+        /* No scan: join the known access point on its channel */
+        WiFi.begin(WIFI_SSID, WIFI_PASS, static_cast<int32_t>(Lease.channel), Lease.bssid);
+        enter(State::WifiConnecting);
+        return;
+    }
+#endif
+    LOG_INFO("Connecting to WiFi: %s", WIFI_SSID);
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    enter(State::WifiConnecting);
+}
+
+void
+Publisher::waitWifi()
+{
+    if (WiFi.status() == WL_CONNECTED) {
+        const uint32_t address = WiFi.localIP();
+        LOG_INFO("WiFi connected, IP address: %u.%u.%u.%u",
+                 static_cast<unsigned>(address & 0xFF),
+                 static_cast<unsigned>((address >> 8) & 0xFF),
+                 static_cast<unsigned>((address >> 16) & 0xFF),
+                 static_cast<unsigned>((address >> 24) & 0xFF));
+#if AIROCAT_FAST_CONNECT
+        remember();
+#endif
+        _attempts = 0;
+        enter(State::MqttConnecting);
+        return;
+    }
+
+#if AIROCAT_FAST_CONNECT
+    if (_fastConnect && millis() - _timestamp >= kFastConnectTimeout) {
+        LOG_WARNING("WiFi connecting with cached access point failed");
+        forget();
+        /* Fall back to the full scan at once */
+        enter(State::WifiDown);
+        return;
+    }
+#endif
+
+    if (millis() - _timestamp >= kWifiConnectTimeout) {
+        LOG_WARNING("WiFi connecting failed, status=%d", static_cast<int>(WiFi.status()));
+        WiFi.disconnect();
+        retry(State::WifiDown);
+    }
+}
+
+#if AIROCAT_FAST_CONNECT
+void
+Publisher::remember()
+{
+    WifiLease lease{};
+    memcpy(lease.bssid, WiFi.BSSID(), sizeof(lease.bssid));
+    lease.channel = WiFi.channel();
+    lease.ip = WiFi.localIP();
+    lease.gateway = WiFi.gatewayIP();
+    lease.subnet = WiFi.subnetMask();
+    lease.dns = WiFi.dnsIP();
+    /* The static config of this connection is the cached lease itself, otherwise DHCP has renewed it */
+    const bool reused = _fastConnect && Lease.uses < kLeaseUsesMax;
+    lease.uses = reused ? Lease.uses + 1 : 0;
+    if (memcmp(&lease, &Lease, sizeof(lease)) != 0) {
+        Lease = lease;
+        rtcSave(RtcSlot::Wifi, Lease);
     }
+    _fastConnect = true;
 }
 
+void
+Publisher::forget()
+{
+    _fastConnect = false;
+    Lease = WifiLease{};
+    rtcSave(RtcSlot::Wifi, Lease);
+    WiFi.disconnect();
+    /* The zero address switches DHCP client back on */
+    WiFi.config(IPAddress{}, IPAddress{}, IPAddress{});
+}
+#endif
+
 bool
-Publisher::publish(const char* topic, const char* payload, boolean retained)
+Publisher::connectMqtt()
 {
-    return mqttClient.publish(topic, payload, retained);
-}
\ No newline at end of file
+    if (WiFi.status() != WL_CONNECTED) {
+        enter(State::WifiConnecting);
+        return false;
+    }
+
+    LOG_INFO("Connecting to MQTT: %s", MQTT_HOST);
+    /* The stable client ID lets the broker drop the stale session of the device at once */
+    if (mqttClient.connect(deviceId(), MQTT_USER, MQTT_PASS)) {
+        LOG_INFO("MQTT connected");
+        /* Nagle coalesces the bursts of small messages, NODELAY sends each of them at once */
+        wifiClient.setNoDelay(AIROCAT_NODELAY);
+        for (uint8_t i = 0; i < _subscriptionsCount; ++i) {
+            mqttClient.subscribe(_subscriptions[i].topic);
+        }
+        _attempts = 0;
+        enter(State::Connected);
+        return true;
+    }
+
+    LOG_WARNING("MQTT connecting failed, rc=%d", mqttClient.state());
+    retry(State::MqttConnecting);
+    return false;
+}
+
+void
+Publisher::checkConnection()
+{
+    if (WiFi.status() != WL_CONNECTED) {
+        LOG_WARNING("WiFi connection lost");
+        mqttClient.disconnect();
+        /* Reassociation is handled by auto reconnect of WiFi stack */
+        enter(State::WifiConnecting);
+        return;
+    }
+
+    if (!mqttClient.loop()) {
+        LOG_WARNING("MQTT connection lost");
+        enter(State::MqttConnecting);
+        return;
+    }
+
+#if AIROCAT_QUEUE
+    flush();
+#endif
+#if AIROCAT_BACKLOG
+    drain();
+#endif
+}
+
+void
+Publisher::dispatch(const char* topic, const uint8_t* payload, size_t length)
+{
+    for (uint8_t i = 0; i < _subscriptionsCount; ++i) {
+        if (strcmp(_subscriptions[i].topic, topic) == 0) {
+            _subscriptions[i].handler(topic, payload, length);
+        }
+    }
+}
+
+#if AIROCAT_BACKLOG
+void
+Publisher::drain()
+{
+    /* Send a single batch per call at limited rate to not starve the sensors reading */
+    if (_backlog.empty() || millis() - _drainTimestamp < kDrainPeriod) {
+        return;
+    }
+#if AIROCAT_QUEUE
+    /* The batches wait for the queue to flush to not push the fresh values out of it */
+    if (!_outbox.empty()) {
+        return;
+    }
+#endif
+    _drainTimestamp = millis();
+
+    Probe probe{Phase::Publish};
+
+#if AIROCAT_STAMP
+    static StaticJsonDocument<JSON_ARRAY_SIZE(kDrainBatch)
+                              + kDrainBatch
+                                    * (JSON_OBJECT_SIZE(2) + sizeof(MetricInfo::key) + kStampCapacity)>
+        json;
+#else
+    static StaticJsonDocument<JSON_ARRAY_SIZE(kDrainBatch)
+                              + kDrainBatch * (JSON_OBJECT_SIZE(2) + sizeof(MetricInfo::key))>
+        json;
+#endif
+
+    json.clear();
+    const auto count = _backlog.peek(json.to<JsonArray>(), kDrainBatch);
+    char topic[64];
+    deviceTopic(kBacklogTopicName, topic, sizeof(topic));
+    if (publish(topic, json, false)) {
+        _backlog.pop(count);
+    }
+}
+#endif
+
+#if AIROCAT_QUEUE
+void
+Publisher::flush()
+{
+    Outbox::Message message;
+    while (_outbox.front(message)) {
+        /* The whole message fits into the free space, so the write does not wait for ACKs */
+        const auto frame = frameSize(strlen(message.topic), message.length);
+        const auto room = static_cast<size_t>(std::max(wifiClient.availableForWrite(), 0));
+        if (room < std::min(frame, kSegmentSize)) {
+            return;
+        }
+        if (!send(message)) {
+            return;
+        }
+        _outbox.pop();
+    }
+}
+#endif
@@ -1,20 +1,134 @@
 #pragma once
 
 #include <Arduino.h>
+#include <ArduinoJson.h>
 
+#include <functional>
+
+#include "Backlog.hpp"
+#include "Outbox.hpp"
+
+/**
+ * Maintains the WiFi and MQTT connections without blocking the caller.
+ * Each call of loop() advances the connection state machine by a single step,
+ * so the sensors keep being read at full rate during outages.
+ */
 class Publisher {
 public:
+    enum class State {
+        WifiDown = 0,
+        WifiConnecting,
+        MqttConnecting,
+        Connected,
+    };
+
+    using Handler = std::function<void(const char* topic, const uint8_t* payload, size_t length)>;
+
     Publisher() = default;
 
     [[nodiscard]] bool
     connected() const;
 
+    [[nodiscard]] State
+    state() const;
+
     void
     setup();
 
+    /* Advances connection state machine, returns true once connection is (re)established */
+    bool
+    loop();
+
+    /* Returns the number of milliseconds till the next step of connection state machine */
+    [[nodiscard]] uint32_t
+    due() const;
+
+    /* Subscribes to the topic (renewed after every reconnect) and passes its messages to the handler */
     void
-    connect();
+    subscribe(const char* topic, Handler handler);
 
+    /**
+     * Serializes the document straight into the MQTT connection without intermediate buffers
+     * or, if AIROCAT_QUEUE is enabled, into the outbound queue flushed as the TCP send buffer frees up.
+     */
     [[nodiscard]] bool
-    publish(const char* topic, const char* payload, bool retained = true);
-};
\ No newline at end of file
+    publish(const char* topic, const JsonDocument& json, bool retained = true);
+
+#if AIROCAT_BACKLOG
+    [[nodiscard]] Backlog&
+    backlog();
+#endif
+
+#if AIROCAT_QUEUE
+    [[nodiscard]] const Outbox&
+    outbox() const;
+#endif
+
+private:
+    void
+    enter(State state, uint32_t delay = 0);
+
+    void
+    retry(State state);
+
+    void
+    connectWifi();
+
+#if AIROCAT_FAST_CONNECT
+    /* Caches the access point and IP lease of established connection for the next boot */
+    void
+    remember();
+
+    /* Drops the cache which failed to connect, the next attempt scans and asks DHCP */
+    void
+    forget();
+#endif
+
+    void
+    waitWifi();
+
+    bool
+    connectMqtt();
+
+    void
+    checkConnection();
+
+    void
+    dispatch(const char* topic, const uint8_t* payload, size_t length);
+
+#if AIROCAT_BACKLOG
+    void
+    drain();
+#endif
+
+#if AIROCAT_QUEUE
+    /* Sends the queued messages while the TCP send buffer has room for them */
+    void
+    flush();
+#endif
+
+private:
+    struct Subscription {
+        const char* topic;
+        Handler handler;
+    };
+
+    static constexpr uint8_t kSubscriptionsMax = 4;
+
+    State _state{State::WifiDown};
+    uint32_t _timestamp{0};
+    uint32_t _delay{0};
+    uint8_t _attempts{0};
+#if AIROCAT_FAST_CONNECT
+    bool _fastConnect{false};
+#endif
+    Subscription _subscriptions[kSubscriptionsMax];
+    uint8_t _subscriptionsCount{0};
+#if AIROCAT_BACKLOG
+    Backlog _backlog;
+    uint32_t _drainTimestamp{0};
+#endif
+#if AIROCAT_QUEUE
+    Outbox _outbox;
+#endif
+};
@@ -0,0 +1,91 @@
+#include "Recorder.hpp"
+
+#include "Log.hpp"
+
+#if AIROCAT_RECORD
+
+#if AIROCAT_RECORD == AIROCAT_RECORD_FILE
+#include <LittleFS.h>
+#endif
+
+namespace {
+
+trace::Encoder Encoder;
+
+#if AIROCAT_RECORD == AIROCAT_RECORD_FILE
+/* The trace file */
+const char* kTracePath = "/trace.bin";
+
+/* The records waiting to be appended to the file in single write */
+uint8_t Chunk[512];
+size_t ChunkSize{0};
+bool Stopped{false};
+
+void
+flush()
+{
+    File file = LittleFS.open(kTracePath, "a");
+    if (!file) {
+        LOG_ERROR("Recorder: Unable to open trace");
+        Stopped = true;
+        return;
+    }
+    if (file.size() == 0) {
+        file.write(reinterpret_cast<const uint8_t*>(trace::kMagic), sizeof(trace::kMagic));
+    }
+    file.write(Chunk, ChunkSize);
+    ChunkSize = 0;
+    if (file.size() >= AIROCAT_RECORD_LIMIT) {
+        LOG_WARNING("Recorder: Trace limit reached");
+        Stopped = true;
+    }
+    file.close();
+}
+#endif
+
+} // namespace
+
+void
+recordSetup()
+{
+#if AIROCAT_RECORD == AIROCAT_RECORD_FILE
+    if (!LittleFS.begin()) {
+        LOG_ERROR("Recorder: Unable to mount filesystem");
+        Stopped = true;
+        return;
+    }
+    if (LittleFS.exists(kTracePath)) {
+        File file = LittleFS.open(kTracePath, "r");
+        LOG_INFO("Recorder: Appending to trace of %lu bytes", static_cast<unsigned long>(file.size()));
+        Stopped = (file.size() >= AIROCAT_RECORD_LIMIT);
+        file.close();
+    }
+#endif
+}
+
+void
+record(const trace::Sample& sample)
+{
+    uint8_t buffer[trace::kEncodedMax];
+#if AIROCAT_RECORD == AIROCAT_RECORD_FILE
+    if (Stopped) {
+        return;
+    }
+    const auto size = Encoder.encode(sample, buffer);
+    if (ChunkSize + size > sizeof(Chunk)) {
+        flush();
+    }
+    memcpy(Chunk + ChunkSize, buffer, size);
+    ChunkSize += size;
+#else
+    const auto size = Encoder.encode(sample, buffer);
+    char line[3 + 2 * trace::kEncodedMax + 1];
+    size_t length = snprintf(line, sizeof(line), "#T ");
+    for (size_t i = 0; i < size; ++i) {
+        length += snprintf(line + length, sizeof(line) - length, "%02x", buffer[i]);
+    }
+    logLine(line);
+#endif
+}
+
+#endif
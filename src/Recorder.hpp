@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+
+/* The destinations of raw readings selected by AIROCAT_RECORD */
+#define AIROCAT_RECORD_NONE 0
+#define AIROCAT_RECORD_FILE 1
+#define AIROCAT_RECORD_SERIAL 2
+
+#if AIROCAT_RECORD
+#include <TraceFormat.h>
+
+/**
+ * Opens the trace of raw readings (see TraceFormat.h): the file in LittleFS, appended to
+ * across reboots until it reaches AIROCAT_RECORD_LIMIT bytes, or the serial output.
+ */
+void
+recordSetup();
+
+/**
+ * Appends the reading to the trace. The file is written in chunks to spare the flash, so a reset
+ * loses the readings of the last chunk. The serial output takes a line per record: #T <hex>.
+ */
+void
+record(const trace::Sample& sample);
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+#include <coredecls.h>
+
+/**
+ * The offsets (in 4-byte blocks) of records kept in RTC user memory (128 blocks).
+ * The memory survives resets and deep sleep but not power loss, so every record
+ * is guarded by CRC. The OTA update overwrites the first 32 blocks, so the records
+ * are kept above them and survive it.
+ */
+enum class RtcSlot : uint32_t {
+    /* The hash of discovery configs (2 blocks) */
+    Discovery = 32,
+    /* The access point and IP lease of the last WiFi connection (8 blocks) */
+    Wifi = 34,
+    /* The last published values and their ages (26 blocks) */
+    Values = 42,
+    /* The BSEC state (57 blocks) */
+    Bsec = 68,
+    /* The end of RTC user memory */
+    End = 128,
+};
+
+/* Returns the number of blocks the record of the data takes, see rtcSave() */
+template<typename T>
+constexpr uint32_t
+rtcBlocks()
+{
+    return (sizeof(uint32_t) + sizeof(T) + 3) / 4;
+}
+
+/* Returns true if the record of the data fits between the slot and the next one */
+template<typename T>
+constexpr bool
+rtcFits(RtcSlot slot, RtcSlot next)
+{
+    return static_cast<uint32_t>(slot) + rtcBlocks<T>() <= static_cast<uint32_t>(next);
+}
+
+/* Reads the record saved by rtcSave(), returns false if memory is uninitialized or corrupted */
+template<typename T>
+bool
+rtcLoad(RtcSlot slot, T& data)
+{
+    struct alignas(4) {
+        uint32_t crc;
+        T data;
+    } record;
+
+    if (!ESP.rtcUserMemoryRead(static_cast<uint32_t>(slot),
+                               reinterpret_cast<uint32_t*>(&record),
+                               sizeof(record))) {
+        return false;
+    }
+    if (record.crc != crc32(&record.data, sizeof(T))) {
+        return false;
+    }
+    data = record.data;
+    return true;
+}
+
+template<typename T>
+bool
+rtcSave(RtcSlot slot, const T& data)
+{
+    struct alignas(4) {
+        uint32_t crc;
+        T data;
+    } record;
+
+    record.data = data;
+    record.crc = crc32(&record.data, sizeof(T));
+    return ESP.rtcUserMemoryWrite(static_cast<uint32_t>(slot),
+                                  reinterpret_cast<uint32_t*>(&record),
+                                  sizeof(record));
+}
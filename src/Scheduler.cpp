@@ -0,0 +1,38 @@
+#include "Scheduler.hpp"
+
+#include <coredecls.h>
+
+namespace {
+
+/* The longest sleep to keep the stack serviced even if nothing is due */
+constexpr const auto kSleepMax = UINT32_C(1000);
+
+/* Set by interrupt handlers, cleared once the sleep is over */
+volatile bool Woken{false};
+
+} // namespace
+
+void
+Scheduler::due(uint32_t ms)
+{
+    _timeout = std::min(_timeout, ms);
+}
+
+void
+Scheduler::sleep()
+{
+    const auto timeout = _timeout;
+    _timeout = kSleepMax;
+    if (timeout > 0) {
+        /* The wakeup which happened after the deadlines were reported ends the sleep immediately */
+        esp_delay(timeout, [] { return !Woken; });
+    }
+    Woken = false;
+}
+
+void IRAM_ATTR
+Scheduler::wake()
+{
+    Woken = true;
+    esp_schedule();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Lets the CPU idle between loop() passes. Each pass reports the time left till the components
+ * need to run again and the scheduler sleeps until the earliest of them or until an interrupt
+ * wakes it up.
+ */
+class Scheduler {
+public:
+    Scheduler() = default;
+
+    /* Limits the next sleep by the number of milliseconds till the component is due */
+    void
+    due(uint32_t ms);
+
+    /* Sleeps until the earliest reported deadline or wake() call */
+    void
+    sleep();
+
+    /* Interrupts the sleep, safe to call from interrupt handlers */
+    static void IRAM_ATTR
+    wake();
+
+private:
+    uint32_t _timeout{0};
+};
@@ -1,11 +1,15 @@
 #include "Sensor1.hpp"
 
 #include <bsec.h>
+
+#include "Diagnostics.hpp"
+#include "Log.hpp"
+#include "Recorder.hpp"
 #if AIROCAT_STATE
-#include <EEPROM.h>
+#include "Journal.hpp"
 #endif
-#if HOMEASSISTANT_INTEGRATE
-#include <ArduinoJson.h>
+#if AIROCAT_WARM_BOOT
+#include "Rtc.hpp"
 #endif
 
 namespace {
@@ -13,10 +17,37 @@ namespace {
 /* The sensor object declaration */
 Bsec Sensor;
 
-/* Save state period: every 360 minutes (4 times a day) */
-constexpr const auto kSaveStatePeriod = UINT32_C(3 * 60 * 1000);
+/* The bus and the address the BSEC library accesses the sensor registers through */
+struct BusInterface {
+    Bus* bus;
+    uint8_t address;
+} Interface{};
+
+int8_t
+busRead(uint8_t reg, uint8_t* data, uint32_t length, void* intf)
+{
+    const auto* interface = static_cast<BusInterface*>(intf);
+    return interface->bus->read(BusDevice::Bme680, interface->address, reg, data, length);
+}
+
+int8_t
+busWrite(uint8_t reg, const uint8_t* data, uint32_t length, void* intf)
+{
+    const auto* interface = static_cast<BusInterface*>(intf);
+    return interface->bus->write(BusDevice::Bme680, interface->address, reg, data, length);
+}
+
+void
+busDelay(uint32_t period, void* /*intf*/)
+{
+    /* The heater duration is waited in milliseconds to let the WiFi stack run */
+    if (period >= 1000) {
+        delay(period / 1000);
+    }
+    delayMicroseconds(period % 1000);
+}
+
 
-#if AIROCAT_STATE
 /**
  * Configure the BSEC library:
  * 18v/33v = Voltage at Vdd. 1.8V or 3.3V
@@ -33,9 +64,21 @@ constexpr const auto kSaveStatePeriod = UINT32_C(3 * 60 * 1000);
  * - generic_33v_300s_4d
  * - generic_33v_300s_28d
  */
+#if AIROCAT_SAMPLE_RATE == AIROCAT_SAMPLE_RATE_ULP
+const uint8 BsecConfig[] = {
+#include "config/generic_33v_300s_4d/bsec_iaq.txt"
+};
+constexpr float kSampleRate = BSEC_SAMPLE_RATE_ULP;
+#elif AIROCAT_SAMPLE_RATE == AIROCAT_SAMPLE_RATE_LP
 const uint8 BsecConfig[] = {
 #include "config/generic_33v_3s_4d/bsec_iaq.txt"
 };
+constexpr float kSampleRate = BSEC_SAMPLE_RATE_LP;
+#elif AIROCAT_SAMPLE_RATE == AIROCAT_SAMPLE_RATE_CONT
+/* There is no generic config for continuous mode, the default one of the library is used */
+constexpr float kSampleRate = BSEC_SAMPLE_RATE_CONT;
+#else
+#error "Unknown BME680 sample rate"
 #endif
 
 /* The list of sensors to activate */
@@ -53,71 +96,81 @@ bsec_virtual_sensor_t BsecSensorList[13] = {BSEC_OUTPUT_IAQ,
                                             BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_HUMIDITY,
                                             BSEC_OUTPUT_GAS_PERCENTAGE};
 
-#if AIROCAT_STATE
+#if AIROCAT_STATE || AIROCAT_WARM_BOOT
 /* The sensor state data */
-uint8_t BsecState[BSEC_MAX_STATE_BLOB_SIZE]{};
+struct StateBlob {
+    uint8_t data[BSEC_MAX_STATE_BLOB_SIZE];
+} BsecState{};
+#endif
+#if AIROCAT_WARM_BOOT
+static_assert(rtcFits<StateBlob>(RtcSlot::Bsec, RtcSlot::End), "The BSEC state overlaps the end of RTC memory");
+#endif
+
+#if AIROCAT_STATE
+/* The copies of the sensor state in LittleFS */
+Journal StateJournal{"/bsec"};
+
+/* The journal is mounted and its newest copy is found on the first access */
+bool JournalMounted{false};
+
+/* Mounts the journal and reads its newest copy into the state data */
+bool
+mountJournal()
+{
+    JournalMounted = true;
+    if (!StateJournal.setup()) {
+        LOG_WARNING("BME680: Sensor state is not kept");
+        return false;
+    }
+    return StateJournal.load(BsecState.data, sizeof(BsecState.data));
+}
+#endif
+
+#if AIROCAT_WARM_BOOT
+/* The period to copy the sensor state to RTC memory */
+constexpr const auto kRtcStatePeriod = UINT32_C(60 * 1000);
 #endif
 
-/* The MQTT topics to publish to */
-const char* kIaqTopic = "airocat/iaq";
-const char* kCo2EqTopic = "airocat/co2Eq";
-const char* kBreathVocEqTopic = "airocat/breathVocEq";
-const char* kTemperatureTopic = "airocat/temperature";
-const char* kHumidityTopic = "airocat/humidity";
-const char* kPressureTopic = "airocat/pressure";
-const char* kGasResistanceTopic = "airocat/gasResistance";
-const char* kGasPercentageTopic = "airocat/gasPercentage";
-const char* kInitStabStatusTopic = "airocat/initialStabStatus";
-const char* kPowerOnStabStatusTopic = "airocat/powerOnStabStatus";
+/* The range of metrics provided by the sensor */
+constexpr auto kFirstMetric = Metric::Iaq;
+constexpr auto kLastMetric = Metric::PowerOnStabStatus;
 
 } // namespace
 
-Sensor1::Sensor1(Publisher& publisher)
-    : _publisher{publisher}
-    , _iaq{publisher, "IAQ", kIaqTopic}
-    , _co2Eq{publisher, "CO2 (equivalent)", kCo2EqTopic}
-    , _breathVocEq{publisher, "BreathVoc (equivalent)", kBreathVocEqTopic}
-    , _temperature{publisher, "Temperature, °C", kTemperatureTopic}
-    , _humidity{publisher, "Humidity, %", kHumidityTopic}
-    , _pressure{publisher, "Pressure, hPa", kPressureTopic}
-    , _gasResistance{publisher, "Gar (resistance), Ohm", kGasResistanceTopic}
-    , _gasPercentage{publisher, "Gar (percentage), %", kGasPercentageTopic}
-    , _initialStatus{publisher, "Initial stabilization status", kInitStabStatusTopic, -1.f}
-    , _powerOnStatus{publisher, "Power-on stabilization status", kPowerOnStabStatusTopic, -1.f}
+Sensor1::Sensor1(DataSet& data, Bus& bus)
+    : _data{data}
+    , _bus{bus}
 {
 }
 
 bool
 Sensor1::setup(uint8_t address)
 {
-#if AIROCAT_STATE
-    EEPROM.begin(BSEC_MAX_STATE_BLOB_SIZE + 1);
-#endif
-
-    Sensor.begin(address, Wire);
+    Interface = BusInterface{&_bus, address};
+    Sensor.begin(BME68X_I2C_INTF, busRead, busWrite, busDelay, &Interface);
     if (!verifyStatus()) {
-        Serial.println("BME680: Error on init");
+        LOG_ERROR("BME680: Error on init");
         return false;
     }
 
-#if AIROCAT_STATE
+#if AIROCAT_SAMPLE_RATE != AIROCAT_SAMPLE_RATE_CONT
     Sensor.setConfig(BsecConfig);
     if (!verifyStatus()) {
-        Serial.println("BME680: Error on set config");
+        LOG_ERROR("BME680: Error on set config");
         return false;
     }
 #endif
 
-    Sensor.updateSubscription(BsecSensorList, 13, BSEC_SAMPLE_RATE_CONT);
+    Sensor.updateSubscription(BsecSensorList, 13, kSampleRate);
     if (!verifyStatus()) {
-        Serial.println("BME680: Error on update subscription");
+        LOG_ERROR("BME680: Error on update subscription");
         return false;
     }
 
-#if AIROCAT_STATE
+#if AIROCAT_STATE || AIROCAT_WARM_BOOT
     loadState();
     if (!verifyStatus()) {
-        Serial.println("BME680:  Error on load sensor state");
+        LOG_ERROR("BME680: Error on load sensor state");
         return false;
     }
 #endif
@@ -125,197 +178,101 @@ Sensor1::setup(uint8_t address)
     return true;
 }
 
-#if HOMEASSISTANT_INTEGRATE
-void
-Sensor1::integrate()
-{
-    DynamicJsonDocument json{256};
-    String output;
-    json["device_class"] = "aqi";
-    json["entity_category"] = "diagnostic";
-    json["name"] = kIaqTopic;
-    json["state_topic"] = kIaqTopic;
-    json["value_template"] = "{{ value_json.value | round(1) }}";
-    serializeJson(json, output);
-    if (!_publisher.publish("homeassistant/sensor/airocat/iaq/config", &output[0])) {
-        Serial.print("Unable to register: "), Serial.println(kIaqTopic);
-    }
-
-    json.clear(), output.clear();
-    json["entity_category"] = "diagnostic";
-    json["name"] = kCo2EqTopic;
-    json["state_topic"] = kCo2EqTopic;
-    json["value_template"] = "{{ value_json.value | round(1) }}";
-    serializeJson(json, output);
-    if (!_publisher.publish("homeassistant/sensor/airocat/co2Eq/config", &output[0])) {
-        Serial.print("Unable to register: "), Serial.println(kCo2EqTopic);
-    }
-
-    json.clear(), output.clear();
-    json["entity_category"] = "diagnostic";
-    json["name"] = kBreathVocEqTopic;
-    json["state_topic"] = kBreathVocEqTopic;
-    json["value_template"] = "{{ value_json.value | round(1) }}";
-    serializeJson(json, output);
-    if (!_publisher.publish("homeassistant/sensor/airocat/breathVocEq/config", &output[0])) {
-        Serial.print("Unable to register: "), Serial.println(kBreathVocEqTopic);
-    }
-
-    json.clear(), output.clear();
-    json["device_class"] = "temperature";
-    json["entity_category"] = "diagnostic";
-    json["unit_of_measurement"] = "C";
-    json["name"] = kTemperatureTopic;
-    json["state_topic"] = kTemperatureTopic;
-    json["value_template"] = "{{ value_json.value | round(1) }}";
-    serializeJson(json, output);
-    if (!_publisher.publish("homeassistant/sensor/airocat/temperature/config", &output[0])) {
-        Serial.print("Unable to register: "), Serial.println(kTemperatureTopic);
-    }
-
-    json.clear(), output.clear();
-    json["device_class"] = "humidity";
-    json["unit_of_measurement"] = "%";
-    json["entity_category"] = "diagnostic";
-    json["name"] = kHumidityTopic;
-    json["state_topic"] = kHumidityTopic;
-    json["value_template"] = "{{ value_json.value | round(1) }}";
-    serializeJson(json, output);
-    if (!_publisher.publish("homeassistant/sensor/airocat/humidity/config", &output[0])) {
-        Serial.print("Unable to register: "), Serial.println(kHumidityTopic);
-    }
-
-    json.clear(), output.clear();
-    json["device_class"] = "pressure";
-    json["unit_of_measurement"] = "hPa";
-    json["entity_category"] = "diagnostic";
-    json["name"] = kPressureTopic;
-    json["state_topic"] = kPressureTopic;
-    json["value_template"] = "{{ value_json.value | round(1) }}";
-    serializeJson(json, output);
-    if (!_publisher.publish("homeassistant/sensor/airocat/pressure/config", &output[0])) {
-        Serial.print("Unable to register: "), Serial.println(kPressureTopic);
-    }
-
-    json.clear(), output.clear();
-    json["unit_of_measurement"] = "Ohm";
-    json["entity_category"] = "diagnostic";
-    json["name"] = kGasResistanceTopic;
-    json["state_topic"] = kGasResistanceTopic;
-    json["value_template"] = "{{ value_json.value | round(1) }}";
-    serializeJson(json, output);
-    if (!_publisher.publish("homeassistant/sensor/airocat/gasResistance/config", &output[0])) {
-        Serial.print("Unable to register: "), Serial.println(kGasResistanceTopic);
-    }
-
-    json.clear(), output.clear();
-    json["unit_of_measurement"] = "%";
-    json["entity_category"] = "diagnostic";
-    json["name"] = kGasPercentageTopic;
-    json["state_topic"] = kGasPercentageTopic;
-    json["value_template"] = "{{ value_json.value | round(1) }}";
-    serializeJson(json, output);
-    if (!_publisher.publish("homeassistant/sensor/airocat/gasPercentage/config", &output[0])) {
-        Serial.print("Unable to register: "), Serial.println(kGasPercentageTopic);
-    }
-
-    json.clear(), output.clear();
-    json["entity_category"] = "diagnostic";
-    json["name"] = kInitStabStatusTopic;
-    json["state_topic"] = kInitStabStatusTopic;
-    json["value_template"] = "{{ value_json.value }}";
-    serializeJson(json, output);
-    if (!_publisher.publish("homeassistant/sensor/airocat/initialStabStatus/config", &output[0])) {
-        Serial.print("Unable to register: "), Serial.println(kInitStabStatusTopic);
-    }
-
-    json.clear(), output.clear();
-    json["entity_category"] = "diagnostic";
-    json["name"] = kPowerOnStabStatusTopic;
-    json["state_topic"] = kPowerOnStabStatusTopic;
-    json["value_template"] = "{{ value_json.value }}";
-    serializeJson(json, output);
-    if (!_publisher.publish("homeassistant/sensor/airocat/powerOnStabStatus/config", &output[0])) {
-        Serial.print("Unable to register: "), Serial.println(kPowerOnStabStatusTopic);
-    }
-}
-#endif
-
 bool
 Sensor1::read()
 {
+    Probe probe{Phase::Sensor1};
+
     if (!Sensor.run()) {
         return verifyStatus();
     }
+    if (Sensor.bsecStatus == BSEC_W_SC_CALL_TIMING_VIOLATION) {
+        /* The loop was blocked past the sample slot (e.g. by MQTT connect), BSEC takes the sample late */
+        LOG_DEBUG("BSEC: Sample taken late");
+    }
+
+#if AIROCAT_RECORD
+    record(trace::Sample{trace::Source::Bme680,
+                         millis(),
+                         {Sensor.rawTemperature,
+                          Sensor.rawHumidity,
+                          Sensor.pressure,
+                          Sensor.gasResistance,
+                          Sensor.temperature,
+                          Sensor.humidity,
+                          Sensor.iaq,
+                          Sensor.co2Equivalent,
+                          Sensor.breathVocEquivalent,
+                          Sensor.gasPercentage,
+                          Sensor.stabStatus,
+                          Sensor.runInStatus}});
+#endif
 
-    _iaq.set(Sensor.iaq);
-    _co2Eq.set(Sensor.co2Equivalent);
-    _breathVocEq.set(Sensor.breathVocEquivalent);
-    _temperature.set(Sensor.temperature);
-    _humidity.set(Sensor.humidity);
-    _pressure.set(Sensor.pressure);
-    _gasResistance.set(Sensor.gasResistance);
-    _gasPercentage.set(Sensor.gasPercentage);
-    _initialStatus.set(Sensor.stabStatus);
-    _powerOnStatus.set(Sensor.runInStatus);
+    _data.set(Metric::Iaq, Sensor.iaq);
+    _data.set(Metric::Co2Eq, Sensor.co2Equivalent);
+    _data.set(Metric::BreathVocEq, Sensor.breathVocEquivalent);
+    _data.set(Metric::Temperature, Sensor.temperature);
+    _data.set(Metric::Humidity, Sensor.humidity);
+    _data.set(Metric::Pressure, Sensor.pressure);
+    _data.set(Metric::GasResistance, Sensor.gasResistance);
+    _data.set(Metric::GasPercentage, Sensor.gasPercentage);
+    _data.set(Metric::InitialStabStatus, Sensor.stabStatus);
+    _data.set(Metric::PowerOnStabStatus, Sensor.runInStatus);
 
 #if AIROCAT_STATE
     saveState();
     if (!verifyStatus()) {
-        Serial.println("BME680: Unable save sensor state");
+        LOG_ERROR("BME680: Unable save sensor state");
     }
 #endif
+#if AIROCAT_WARM_BOOT
+    keepState();
+#endif
 
     return true;
 }
 
+uint32_t
+Sensor1::due() const
+{
+    const auto now = Sensor.getTimeMs();
+    return (Sensor.nextCall > now) ? static_cast<uint32_t>(Sensor.nextCall - now) : 0;
+}
+
 void
 Sensor1::publish()
 {
-    static auto lastTimestamp{0u};
+    /* The data set publishes every value once per its interval */
+    _data.publish(kFirstMetric, kLastMetric, stabilized());
+}
 
-    const auto currTimestamp = millis();
-    const auto delay = currTimestamp - lastTimestamp;
+void
+Sensor1::collect(JsonObject state, uint32_t& acquired)
+{
+    _data.collect(state, kFirstMetric, kLastMetric, stabilized(), acquired);
+}
 
-    bool needPublish{false};
-    if (delay >= AIROCAT_DELAY) {
-        lastTimestamp = currTimestamp;
-        needPublish = true;
-    }
+void
+Sensor1::commit(bool published)
+{
+    _data.commit(kFirstMetric, kLastMetric, published);
+}
 
-    if (needPublish) {
-        if (!_iaq.published() && stabilized()) {
-            _iaq.publish();
-        }
-        if (!_co2Eq.published() && stabilized()) {
-            _co2Eq.publish();
-        }
-        if (!_breathVocEq.published()) {
-            _breathVocEq.publish();
-        }
-        if (!_temperature.published()) {
-            _temperature.publish();
-        }
-        if (!_humidity.published()) {
-            _humidity.publish();
-        }
-        if (!_pressure.published()) {
-            _pressure.publish();
-        }
-        if (!_gasResistance.published()) {
-            _gasResistance.publish();
-        }
-        if (!_gasPercentage.published()) {
-            _gasPercentage.publish();
-        }
-        if (!_initialStatus.published()) {
-            _initialStatus.publish();
-        }
-        if (!_powerOnStatus.published()) {
-            _powerOnStatus.publish();
-        }
-    }
+#if AIROCAT_STATISTICS
+void
+Sensor1::summarize(JsonObject state)
+{
+    _data.summarize(state, kFirstMetric, kLastMetric, stabilized());
 }
+#endif
+
+#if AIROCAT_HTTP_PORT
+void
+Sensor1::expose(Print& output) const
+{
+    _data.expose(output, kFirstMetric, kLastMetric, stabilized());
+}
+#endif
 
 bool
 Sensor1::stabilized() const
@@ -326,135 +283,157 @@ Sensor1::stabilized() const
 Sensor1::Status
 Sensor1::initialStabStatus() const
 {
-    return (_initialStatus.get() == 0.f) ? Status::Ongoing : Status::Finished;
+    return (_data.get(Metric::InitialStabStatus) == 0.f) ? Status::Ongoing : Status::Finished;
 }
 
 Sensor1::Status
 Sensor1::powerOnStabStatus() const
 {
-    return (_powerOnStatus.get() == 0.f) ? Status::Ongoing : Status::Finished;
+    return (_data.get(Metric::PowerOnStabStatus) == 0.f) ? Status::Ongoing : Status::Finished;
 }
 
 float
 Sensor1::iaq() const
 {
-    return _iaq.get();
+    return _data.get(Metric::Iaq);
 }
 
 float
 Sensor1::co2Eq() const
 {
-    return _co2Eq.get();
+    return _data.get(Metric::Co2Eq);
 }
 
 float
 Sensor1::breathVocEq() const
 {
-    return _breathVocEq.get();
+    return _data.get(Metric::BreathVocEq);
 }
 
 float
 Sensor1::temperature() const
 {
-    return _temperature.get();
+    return _data.get(Metric::Temperature);
 }
 
 float
 Sensor1::humidity() const
 {
-    return _humidity.get();
+    return _data.get(Metric::Humidity);
 }
 
 float
 Sensor1::pressure() const
 {
-    return _pressure.get();
+    return _data.get(Metric::Pressure);
 }
 
 float
 Sensor1::gasResistance() const
 {
-    return _gasResistance.get();
+    return _data.get(Metric::GasResistance);
 }
 
 float
 Sensor1::gasPercentage() const
 {
-    return _gasPercentage.get();
+    return _data.get(Metric::GasPercentage);
 }
 
 bool
 Sensor1::verifyStatus()
 {
-    String output;
     if (Sensor.bsecStatus != BSEC_OK) {
         if (Sensor.bsecStatus < BSEC_OK) {
-            output = "BSEC: Error " + String(Sensor.bsecStatus);
-            Serial.println(output);
+            LOG_ERROR("BSEC: Error %d", static_cast<int>(Sensor.bsecStatus));
             return false;
         } else {
-            output = "BSEC: Warning " + String(Sensor.bsecStatus);
-            Serial.println(output);
+            LOG_WARNING("BSEC: Warning %d", static_cast<int>(Sensor.bsecStatus));
         }
     }
     if (Sensor.bme68xStatus != BME68X_OK) {
         if (Sensor.bme68xStatus < BME68X_OK) {
-            output = "BME680: Error " + String(Sensor.bme68xStatus);
-            Serial.println(output);
+            LOG_ERROR("BME680: Error %d", static_cast<int>(Sensor.bme68xStatus));
             return false;
         } else {
-            output = "BME680: Warning" + String(Sensor.bme68xStatus);
-            Serial.println(output);
+            LOG_WARNING("BME680: Warning %d", static_cast<int>(Sensor.bme68xStatus));
         }
     }
     return true;
 }
 
-#if AIROCAT_STATE
+#if AIROCAT_STATE || AIROCAT_WARM_BOOT
 void
 Sensor1::loadState()
 {
-    if (EEPROM.read(0) == BSEC_MAX_STATE_BLOB_SIZE) {
-        Serial.println("BME680: Reading state from EEPROM");
-        for (uint8_t i = 0; i < BSEC_MAX_STATE_BLOB_SIZE; i++) {
-            BsecState[i] = EEPROM.read(i + 1);
-        }
-        Sensor.setState(BsecState);
-    } else {
-        Serial.println("BME680: Erasing EEPROM");
-        for (uint8_t i = 0; i < BSEC_MAX_STATE_BLOB_SIZE + 1; i++) {
-            EEPROM.write(i, 0);
-        }
-        EEPROM.commit();
+#if AIROCAT_WARM_BOOT
+    /* The copy in RTC memory is the most recent one, the flash is read only after power loss */
+    if (rtcLoad(RtcSlot::Bsec, BsecState)) {
+        LOG_INFO("BME680: Restoring state kept in RTC memory");
+        Sensor.setState(BsecState.data);
+        return;
+    }
+#endif
+#if AIROCAT_STATE
+    if (mountJournal()) {
+        LOG_INFO("BME680: Restoring saved state");
+        Sensor.setState(BsecState.data);
+        return;
     }
+#endif
+    LOG_INFO("BME680: No saved state");
 }
+#endif
+
+#if AIROCAT_STATE
 
 void
 Sensor1::saveState()
 {
-    static uint32 saveCounter{0};
+    static uint32_t lastTimestamp{0};
+    static bool saved{false};
+
     bool needUpdate = false;
-    if (saveCounter == 0) {
+    if (!saved) {
         /* First state update when IAQ accuracy is >= 3 */
-        if (Sensor.iaqAccuracy >= 3) {
-            needUpdate = true;
-            saveCounter++;
-        }
+        needUpdate = (Sensor.iaqAccuracy >= 3);
     } else {
-        /* Update every kSaveStatePeriod minutes */
-        if ((saveCounter * kSaveStatePeriod) < millis()) {
-            needUpdate = true;
-            saveCounter++;
-        }
+        /* Update every AIROCAT_STATE_PERIOD ms */
+        needUpdate = (millis() - lastTimestamp >= AIROCAT_STATE_PERIOD);
     }
     if (needUpdate) {
-        Serial.println("BME680: Writing state to EEPROM");
-        Sensor.getState(BsecState);
-        for (uint8_t i = 0; i < BSEC_MAX_STATE_BLOB_SIZE; i++) {
-            EEPROM.write(i + 1, BsecState[i]);
+        Probe probe{Phase::Storage};
+        LOG_DEBUG("BME680: Saving state");
+        if (!JournalMounted) {
+            /* The save goes next to the newest copy which is unknown if the state came from RTC memory */
+            mountJournal();
         }
-        EEPROM.write(0, BSEC_MAX_STATE_BLOB_SIZE);
-        EEPROM.commit();
+        Sensor.getState(BsecState.data);
+        if (!StateJournal.save(BsecState.data, sizeof(BsecState.data))) {
+            LOG_ERROR("BME680: Unable to save state");
+        }
+        /* Do not retry failed save on each sample */
+        lastTimestamp = millis();
+        saved = true;
+    }
+}
+#endif
+
+#if AIROCAT_WARM_BOOT
+void
+Sensor1::keepState()
+{
+    static uint32_t lastTimestamp{0};
+    static bool kept{false};
+
+    if (kept && millis() - lastTimestamp < kRtcStatePeriod) {
+        return;
+    }
+    Sensor.getState(BsecState.data);
+    if (Sensor.bsecStatus == BSEC_OK) {
+        rtcSave(RtcSlot::Bsec, BsecState);
     }
+    lastTimestamp = millis();
+    kept = true;
 }
-#endif
\ No newline at end of file
+#endif
@@ -2,9 +2,13 @@
 
 #include <Arduino.h>
 
-#include "DataValue.hpp"
+#include "Bus.hpp"
+#include "DataSet.hpp"
 
-class Publisher;
+/* The BME680 sample rates selected by AIROCAT_SAMPLE_RATE */
+#define AIROCAT_SAMPLE_RATE_CONT 0
+#define AIROCAT_SAMPLE_RATE_LP 1
+#define AIROCAT_SAMPLE_RATE_ULP 2
 
 class Sensor1 {
 public:
@@ -13,22 +17,37 @@ public:
         Finished,
     };
 
-    explicit Sensor1(Publisher& publisher);
+    Sensor1(DataSet& data, Bus& bus);
 
     [[nodiscard]] bool
     setup(uint8_t address);
 
-#if HOMEASSISTANT_INTEGRATE
-    void
-    integrate();
-#endif
-
     [[nodiscard]] bool
     read();
 
+    /* Returns the number of milliseconds till BSEC expects the next call */
+    [[nodiscard]] uint32_t
+    due() const;
+
     void
     publish();
 
+    void
+    collect(JsonObject state, uint32_t& acquired);
+
+    void
+    commit(bool published);
+
+#if AIROCAT_STATISTICS
+    void
+    summarize(JsonObject state);
+#endif
+
+#if AIROCAT_HTTP_PORT
+    void
+    expose(Print& output) const;
+#endif
+
     [[nodiscard]] bool
     stabilized() const;
 
@@ -66,24 +85,23 @@ private:
     static bool
     verifyStatus();
 
-#if AIROCAT_STATE
+#if AIROCAT_STATE || AIROCAT_WARM_BOOT
     static void
     loadState();
+#endif
 
+#if AIROCAT_STATE
     static void
     saveState();
 #endif
 
+#if AIROCAT_WARM_BOOT
+    /* Copies the sensor state to RTC memory once per minute to resume with it after reset */
+    static void
+    keepState();
+#endif
+
 private:
-    Publisher& _publisher;
-    DataValue<float> _iaq;
-    DataValue<float> _co2Eq;
-    DataValue<float> _breathVocEq;
-    DataValue<float> _temperature;
-    DataValue<float> _humidity;
-    DataValue<float> _pressure;
-    DataValue<float> _gasResistance;
-    DataValue<float> _gasPercentage;
-    DataValue<float> _initialStatus;
-    DataValue<float> _powerOnStatus;
+    DataSet& _data;
+    Bus& _bus;
 };
\ No newline at end of file
@@ -1,32 +1,96 @@
 #include "Sensor2.hpp"
 
 #include <SparkFunCCS811.h>
-#include <ArduinoJson.h>
 
-#include "Publisher.hpp"
+#include "Diagnostics.hpp"
+#include "Log.hpp"
+#include "Recorder.hpp"
+#include "Scheduler.hpp"
 
 namespace {
 
 /* The sensor object declaration */
 CCS811 Sensor;
 
-/* The MQTT topics to publish to */
-const char* kCo2Topic = "airocat/co2";
-const char* kTvocTopic = "airocat/tvoc";
+/* The range of metrics provided by the sensor */
+constexpr auto kFirstMetric = Metric::Co2;
+constexpr auto kLastMetric = Metric::Tvoc;
+
+/* The sizes of transfers (register address and data) of driver calls */
+constexpr const size_t kStatusSize = 2;
+constexpr const size_t kResultSize = 5;
+constexpr const size_t kEnvironmentSize = 5;
+constexpr const size_t kErrorSize = 2;
+
+/* The change of compensation values worth writing to the sensor */
+constexpr const float kHumidityThreshold = 1.f;
+constexpr const float kTemperatureThreshold = 0.5f;
+/* The minimal period between writes of compensation values */
+constexpr const auto kCompensationPeriod = UINT32_C(60 * 1000);
+
+/* The period of new data in the drive mode 1 */
+constexpr const auto kDataPeriod = UINT32_C(1000);
+/* The period to poll the status while waiting for new data */
+constexpr const auto kPollPeriod = UINT32_C(50);
+
+/* Calls the driver accounting the call as single bus transaction */
+template<typename Call>
+auto
+transfer(Bus& bus, size_t bytes, Call&& call)
+{
+    Bus::Transaction transaction{bus, BusDevice::Ccs811, bytes};
+    const auto result = call();
+    if constexpr (std::is_enum_v<decltype(result)>) {
+        if (result == CCS811Core::CCS811_Stat_I2C_ERROR) {
+            transaction.fail();
+        }
+    }
+    return result;
+}
+
+#if AIROCAT_CCS811_INT >= 0
+/* The period to poll the sensor anyway in case the interrupt was missed */
+constexpr const auto kInterruptTimeout = UINT32_C(5 * 1000);
+
+/* Set by the falling edge of nINT once new data is ready */
+volatile bool DataReady{false};
+
+void IRAM_ATTR
+onDataReady()
+{
+    DataReady = true;
+    Scheduler::wake();
+}
+#endif
 
 } // namespace
 
-Sensor2::Sensor2(Publisher& publisher)
-    : _publisher{publisher}
-    , _co2{publisher, "CO2, ppm", "airocat/co2"}
-    , _tvoc{publisher, "TVOC, ppb", "airocat/tvoc"}
+Sensor2::Sensor2(DataSet& data, Bus& bus)
+    : _data{data}
+    , _bus{bus}
 {
 }
 
 void
 Sensor2::setEnvironmentalData(float humidity, float temperature)
 {
-    Sensor.setEnvironmentalData(humidity, temperature);
+    if (_compensated) {
+        const bool changed = (fabsf(humidity - _humidity) >= kHumidityThreshold
+                              || fabsf(temperature - _temperature) >= kTemperatureThreshold);
+        if (!changed || millis() - _compensationTimestamp < kCompensationPeriod) {
+            return;
+        }
+    }
+
+    const auto status = transfer(_bus, kEnvironmentSize, [&] {
+        return Sensor.setEnvironmentalData(humidity, temperature);
+    });
+    if (status == CCS811Core::CCS811_Stat_SUCCESS) {
+        _humidity = humidity;
+        _temperature = temperature;
+        _compensationTimestamp = millis();
+        _compensated = true;
+    }
 }
 
 bool
@@ -35,58 +99,64 @@ Sensor2::setup(uint8_t address)
     Sensor.setI2CAddress(address);
 
     if (not Sensor.begin()) {
-        Serial.println(F("Could init CCS811 sensor"));
+        LOG_ERROR("CCS811: Error on init");
         return false;
     }
 
+#if AIROCAT_CCS811_INT >= 0
+    pinMode(AIROCAT_CCS811_INT, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(AIROCAT_CCS811_INT), onDataReady, FALLING);
+    if (Sensor.enableInterrupts() != CCS811Core::CCS811_Stat_SUCCESS) {
+        LOG_ERROR("CCS811: Error on enable interrupt");
+        return false;
+    }
+#endif
+
     return true;
 }
 
-#if HOMEASSISTANT_INTEGRATE
-void
-Sensor2::integrate()
-{
-    static StaticJsonDocument<128> json;
-    String output;
-    json["device_class"] = "carbon_dioxide";
-    json["unit_of_measurement"] = "ppm";
-    json["entity_category"] = "diagnostic";
-    json["name"] = kCo2Topic;
-    json["state_topic"] = kCo2Topic;
-    json["value_template"] = "{{ value_json.value }}";
-    serializeJson(json, output);
-    std::ignore = _publisher.publish("homeassistant/sensor/airocat/co2/config", &output[0], true);
-
-    json.clear(), output.clear();
-    json["device_class"] = "volatile_organic_compounds_parts";
-    json["unit_of_measurement"] = "ppb";
-    json["entity_category"] = "diagnostic";
-    json["name"] = kTvocTopic;
-    json["state_topic"] = kTvocTopic;
-    json["value_template"] = "{{ value_json.value }}";
-    serializeJson(json, output);
-    std::ignore = _publisher.publish("homeassistant/sensor/airocat/tvoc/config", &output[0], true);
-}
-#endif
-
 bool
 Sensor2::read()
 {
-    if (!Sensor.dataAvailable()) {
-        if (Sensor.checkForStatusError()) {
+    if (due() > 0) {
+        return false;
+    }
+
+    Probe probe{Phase::Sensor2};
+
+    _timestamp = millis();
+#if AIROCAT_CCS811_INT >= 0
+    DataReady = false;
+    _delay = kInterruptTimeout;
+#else
+    _delay = kPollPeriod;
+#endif
+
+    if (!transfer(_bus, kStatusSize, [] { return Sensor.dataAvailable(); })) {
+        if (transfer(_bus, kStatusSize, [] { return Sensor.checkForStatusError(); })) {
             reset();
             printError();
         }
         return false;
     }
 
-    if (Sensor.readAlgorithmResults() != CCS811Core::CCS811_Stat_SUCCESS) {
+    if (transfer(_bus, kResultSize, [] { return Sensor.readAlgorithmResults(); })
+        != CCS811Core::CCS811_Stat_SUCCESS) {
         reset();
         return false;
     }
 
-    _co2.set(Sensor.getCO2());
-    _tvoc.set(Sensor.getTVOC());
+#if AIROCAT_RECORD
+    record(trace::Sample{trace::Source::Ccs811,
+                         millis(),
+                         {static_cast<float>(Sensor.getCO2()), static_cast<float>(Sensor.getTVOC())}});
+#endif
+    _data.set(Metric::Co2, Sensor.getCO2());
+    _data.set(Metric::Tvoc, Sensor.getTVOC());
+#if AIROCAT_CCS811_INT < 0
+    /* Sleep till shortly before the next data instead of polling */
+    _delay = kDataPeriod - kPollPeriod;
+#endif
 
     return true;
 }
@@ -94,69 +164,90 @@ Sensor2::read()
 void
 Sensor2::publish()
 {
-    static auto lastTimestamp{0u};
+    /* The data set publishes every value once per its interval */
+    _data.publish(kFirstMetric, kLastMetric, true);
+}
 
-    const auto currTimestamp = millis();
-    const auto delay = currTimestamp - lastTimestamp;
+void
+Sensor2::collect(JsonObject state, uint32_t& acquired)
+{
+    _data.collect(state, kFirstMetric, kLastMetric, true, acquired);
+}
 
-    bool needPublish{false};
-    if (delay >= AIROCAT_DELAY) {
-        lastTimestamp = currTimestamp;
-        needPublish = true;
-    }
+void
+Sensor2::commit(bool published)
+{
+    _data.commit(kFirstMetric, kLastMetric, published);
+}
 
-    if (needPublish) {
-        if (!_co2.published()) {
-            _co2.publish();
-        }
-        if (!_tvoc.published()) {
-            _tvoc.publish();
-        }
+#if AIROCAT_STATISTICS
+void
+Sensor2::summarize(JsonObject state)
+{
+    _data.summarize(state, kFirstMetric, kLastMetric, true);
+}
+#endif
+
+#if AIROCAT_HTTP_PORT
+void
+Sensor2::expose(Print& output) const
+{
+    _data.expose(output, kFirstMetric, kLastMetric, true);
+}
+#endif
+
+uint32_t
+Sensor2::due() const
+{
+#if AIROCAT_CCS811_INT >= 0
+    if (DataReady) {
+        return 0;
     }
+#endif
+    const auto elapsed = millis() - _timestamp;
+    return (elapsed < _delay) ? _delay - elapsed : 0;
 }
 
 uint16_t
 Sensor2::co2() const
 {
-    return _co2.get();
+    return _data.get(Metric::Co2);
 }
 
 uint16_t
 Sensor2::tvoc() const
 {
-    return _tvoc.get();
+    return _data.get(Metric::Tvoc);
 }
 
 void
 Sensor2::reset()
 {
-    _co2.set(0);
-    _tvoc.set(0);
+    _data.set(Metric::Co2, 0);
+    _data.set(Metric::Tvoc, 0);
 }
 
 void
 Sensor2::printError()
 {
-    uint8_t error = Sensor.getErrorRegister();
+    uint8_t error = transfer(_bus, kErrorSize, [] { return Sensor.getErrorRegister(); });
     if (error == 0xFF) {
-        Serial.println("Failed to get error register value");
-    } else {
-        Serial.print("Error: ");
-        if (error & 1 << 5) {
-            Serial.print("HeaterSupply");
-        } else if (error & 1 << 4) {
-            Serial.print("HeaterFault");
-        } else if (error & 1 << 3) {
-            Serial.print("MaxResistance");
-        } else if (error & 1 << 2) {
-            Serial.print("MeasModeInvalid");
-        } else if (error & 1 << 1) {
-            Serial.print("ReadRegInvalid");
-        } else if (error & 1 << 0) {
-            Serial.print("MsgInvalid");
-        } else {
-            Serial.print("Unknown");
-        }
-        Serial.println();
+        LOG_ERROR("CCS811: Failed to get error register value");
+        return;
+    }
+    const char* name = "Unknown";
+    if (error & 1 << 5) {
+        name = "HeaterSupply";
+    } else if (error & 1 << 4) {
+        name = "HeaterFault";
+    } else if (error & 1 << 3) {
+        name = "MaxResistance";
+    } else if (error & 1 << 2) {
+        name = "MeasModeInvalid";
+    } else if (error & 1 << 1) {
+        name = "ReadRegInvalid";
+    } else if (error & 1 << 0) {
+        name = "MsgInvalid";
     }
+    LOG_ERROR("CCS811: Error %s", name);
 }
@@ -2,31 +2,47 @@
 
 #include <Arduino.h>
 
-#include "DataValue.hpp"
-
-class Publisher;
+#include "Bus.hpp"
+#include "DataSet.hpp"
 
 class Sensor2 {
 public:
-    explicit Sensor2(Publisher& publisher);
+    Sensor2(DataSet& data, Bus& bus);
 
+    /* Writes the compensation values if they have changed noticeably, but not too often */
     void
     setEnvironmentalData(float humidity, float temperature);
 
     [[nodiscard]] bool
     setup(uint8_t address);
 
-#if HOMEASSISTANT_INTEGRATE
-    void
-    integrate();
-#endif
-
+    /* Reads the new data once it is ready, the status is not polled in between */
     [[nodiscard]] bool
     read();
 
+    /* Returns the number of milliseconds till the next data is expected */
+    [[nodiscard]] uint32_t
+    due() const;
+
     void
     publish();
 
+    void
+    collect(JsonObject state, uint32_t& acquired);
+
+    void
+    commit(bool published);
+
+#if AIROCAT_STATISTICS
+    void
+    summarize(JsonObject state);
+#endif
+
+#if AIROCAT_HTTP_PORT
+    void
+    expose(Print& output) const;
+#endif
+
     [[nodiscard]] uint16_t
     co2() const;
 
@@ -37,11 +53,16 @@ private:
     void
     reset();
 
-    static void
+    void
     printError();
 
 private:
-    Publisher& _publisher;
-    DataValue<uint16_t> _co2;
-    DataValue<uint16_t> _tvoc;
+    DataSet& _data;
+    Bus& _bus;
+    float _humidity{0.f};
+    float _temperature{0.f};
+    uint32_t _compensationTimestamp{0};
+    bool _compensated{false};
+    uint32_t _timestamp{0};
+    uint32_t _delay{0};
 };
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "Stamp.hpp"
+
+#if AIROCAT_STAMP
+
+#include <sys/time.h>
+
+namespace {
+
+/* The wall clock is considered synced once it has passed this time (2021-01-01) */
+constexpr const auto kEpochSynced = 1609459200;
+
+/* The sequence number of the last stamped message and whether it was taken */
+uint32_t Sequence{0};
+bool Taken{false};
+
+} // namespace
+
+void
+stampSetup()
+{
+    configTime(0, 0, AIROCAT_NTP_SERVER);
+}
+
+uint64_t
+stampTime(uint32_t timestamp)
+{
+    timeval now{};
+    gettimeofday(&now, nullptr);
+    if (now.tv_sec < kEpochSynced) {
+        return timestamp;
+    }
+    const auto wall = static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_usec / 1000;
+    return wall - (millis() - timestamp);
+}
+
+void
+stamp(JsonDocument& json, uint32_t acquired)
+{
+    const auto published = millis();
+    if (Taken) {
+        Sequence++;
+        Taken = false;
+    }
+    JsonArray compact = json.as<JsonArray>();
+    if (!compact.isNull()) {
+        compact.add(Sequence);
+        compact.add(stampTime(acquired));
+        compact.add(stampTime(published));
+        return;
+    }
+    json["seq"] = Sequence;
+    JsonArray time = json.createNestedArray("time");
+    time.add(stampTime(acquired));
+    time.add(stampTime(published));
+}
+
+uint32_t
+stampTake()
+{
+    Taken = true;
+    return Sequence;
+}
+
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#if AIROCAT_STAMP
+/* The extra capacity of the document taking the stamp */
+constexpr auto kStampCapacity = JSON_OBJECT_SIZE(2) + JSON_ARRAY_SIZE(3);
+
+/* Starts SNTP synchronization of the wall clock */
+void
+stampSetup();
+
+/**
+ * Converts the millis() timestamp into milliseconds since the epoch once the wall clock is synced,
+ * before that the timestamp is returned as is (the consumer tells them apart by the magnitude).
+ */
+[[nodiscard]] uint64_t
+stampTime(uint32_t timestamp);
+
+/**
+ * Adds the sequence number (counted per device since boot) and the times the values were acquired
+ * and published to the message: {..., "seq": <n>, "time": [<acquired>, <published>]} or,
+ * in the compact form, [..., <n>, <acquired>, <published>].
+ * The number is reused by the next message unless taken with stampTake().
+ */
+void
+stamp(JsonDocument& json, uint32_t acquired);
+
+/**
+ * Takes the sequence number of the last stamped message once the message is published or queued
+ * or its values are kept in the backlog, so a gap in the sequence is a value the consumer never gets.
+ */
+uint32_t
+stampTake();
+#endif
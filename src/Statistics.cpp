@@ -0,0 +1,59 @@
+#include "Statistics.hpp"
+
+#if AIROCAT_STATISTICS
+
+#include <ArduinoJson.h>
+
+#include "DataSet.hpp"
+#include "Device.hpp"
+#include "Diagnostics.hpp"
+#include "Log.hpp"
+#include "Metric.hpp"
+#include "Publisher.hpp"
+#include "Sensor1.hpp"
+#include "Sensor2.hpp"
+
+Statistics::Statistics(Publisher& publisher, const DataSet& data)
+    : _publisher{publisher}
+    , _data{data}
+{
+}
+
+void
+Statistics::publish(Sensor1& sensor1, Sensor2& sensor2)
+{
+    if (due() > 0) {
+        return;
+    }
+    _timestamp = millis();
+
+    Probe probe{Phase::Publish};
+
+    static StaticJsonDocument<JSON_OBJECT_SIZE(kMetricCount) + kMetricCount * JSON_ARRAY_SIZE(5)
+                              + sizeof(MetricInfo::key) * kMetricCount>
+        json;
+
+    json.clear();
+    JsonObject state = json.to<JsonObject>();
+    sensor1.summarize(state);
+    sensor2.summarize(state);
+    if (state.size() == 0) {
+        return;
+    }
+    char topic[64];
+    deviceTopic(kTopicName, topic, sizeof(topic));
+    /* The outage is reported by the Publisher, only a failure while connected is logged */
+    if (!_publisher.publish(topic, json, false) && _publisher.connected()) {
+        LOG_WARNING("Unable to publish statistics");
+    }
+}
+
+uint32_t
+Statistics::due() const
+{
+    const auto period = _data.period();
+    const auto elapsed = millis() - _timestamp;
+    return (elapsed < period) ? period - elapsed : 0;
+}
+
+#endif
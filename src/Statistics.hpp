@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+#if AIROCAT_STATISTICS
+
+class DataSet;
+class Publisher;
+class Sensor1;
+class Sensor2;
+
+/**
+ * Publishes min, mean, max and standard deviation of all values read within the shortest publish
+ * interval (see DataSet::period()) as a single message to the statistics topic, so the samples
+ * between publishes are not lost.
+ */
+class Statistics {
+public:
+    /* The topic name under the device prefix (see deviceTopic()) */
+    static constexpr const char* kTopicName = "stats";
+
+    Statistics(Publisher& publisher, const DataSet& data);
+
+    void
+    publish(Sensor1& sensor1, Sensor2& sensor2);
+
+    /* Returns the number of milliseconds till the next publish */
+    [[nodiscard]] uint32_t
+    due() const;
+
+private:
+    Publisher& _publisher;
+    const DataSet& _data;
+    uint32_t _timestamp{0};
+};
+
+#endif
@@ -1,16 +1,50 @@
 #include <Arduino.h>
-#include <Wire.h>
 
+#include "Aggregator.hpp"
+#include "Bus.hpp"
+#include "Control.hpp"
+#include "DataSet.hpp"
+#include "Diagnostics.hpp"
+#include "Discovery.hpp"
+#include "Exporter.hpp"
+#include "Log.hpp"
 #include "Publisher.hpp"
+#include "Recorder.hpp"
+#include "Scheduler.hpp"
 #include "Sensor1.hpp"
 #include "Sensor2.hpp"
+#include "Stamp.hpp"
+#include "Statistics.hpp"
 
 #define BME680_I2C_ADDR (UINT8_C(0x77))
 #define CCS811_I2C_ADDR (UINT8_C(0x5A))
+/* The time for sensors to power up (CCS811 needs 20 ms), the failed init is retried anyway */
+#define SENSORS_POWER_UP_MS (UINT32_C(100))
 
+static Scheduler scheduler;
 static Publisher publisher;
-static Sensor1 sensor1{publisher};
-static Sensor2 sensor2{publisher};
+static DataSet dataSet{publisher};
+static Bus bus;
+static Sensor1 sensor1{dataSet, bus};
+static Sensor2 sensor2{dataSet, bus};
+#if AIROCAT_AGGREGATE
+static Aggregator aggregator{publisher, dataSet};
+#endif
+#if HOMEASSISTANT_INTEGRATE
+static Discovery discovery{publisher};
+#endif
+#if AIROCAT_STATISTICS
+static Statistics statistics{publisher, dataSet};
+#endif
+#if AIROCAT_DIAGNOSTICS
+static Diagnostics diagnostics{publisher, bus};
+#endif
+#if AIROCAT_CONTROL
+static Control control{publisher, dataSet};
+#endif
+#if AIROCAT_HTTP_PORT
+static Exporter exporter{dataSet, sensor1, sensor2};
+#endif
 
 void
 setup()
@@ -21,40 +55,128 @@ setup()
         delay(10);
     }
 
+#if AIROCAT_WARM_BOOT
+    /* Resume with the values published before reset */
+    dataSet.restore();
+#endif
+
+    /* Start associating with access point, it goes on in background while sensors are set up */
+    publisher.setup();
+    publisher.loop();
+#if AIROCAT_STAMP
+    stampSetup();
+#endif
+
+#if AIROCAT_RECORD
+    recordSetup();
+#endif
+
     /* Init I2C on SCL(D1) and SDA(D2) */
-    Wire.begin(D2, D1);
-    delay(1000);
+    bus.setup(D2, D1);
+    delay(SENSORS_POWER_UP_MS);
 
     while (!sensor1.setup(BME680_I2C_ADDR)) {
-        Serial.println(F("Error on init Sensor1"));
+        LOG_ERROR("Error on init Sensor1");
+        logLoop();
         delay(1000);
     }
 
     while (!sensor2.setup(CCS811_I2C_ADDR)) {
-        Serial.println(F("Error on init Sensor2"));
+        LOG_ERROR("Error on init Sensor2");
+        logLoop();
         delay(1000);
     }
 
-    publisher.setup();
+#if AIROCAT_HTTP_PORT
+    exporter.setup();
+#endif
+#if HOMEASSISTANT_INTEGRATE
+    discovery.setup();
+#endif
+#if AIROCAT_CONTROL
+    control.setup();
+#endif
 }
 
 void
 loop()
 {
-    if (!publisher.connected()) {
-        publisher.connect();
+    /* Sleeps until the earliest deadline reported by the previous pass */
+    scheduler.sleep();
+
+#if AIROCAT_DIAGNOSTICS
+    diagnostics.publish();
+#endif
+
+    Probe loopProbe{Phase::Loop};
+
+    if (publisher.loop()) {
 #if HOMEASSISTANT_INTEGRATE
-        sensor1.integrate();
-        sensor2.integrate();
+        discovery.publish();
 #endif
     }
+#if HOMEASSISTANT_INTEGRATE
+    discovery.loop();
+#endif
+#if AIROCAT_CONTROL
+    if (control.loop()) {
+        /* The requested snapshot goes out at once instead of waiting for the next read */
+#if AIROCAT_AGGREGATE
+        aggregator.trigger();
+#else
+        sensor1.publish();
+        sensor2.publish();
+#endif
+    }
+#endif
 
     if (sensor1.read()) {
+#if !AIROCAT_AGGREGATE
         sensor1.publish();
+#endif
         sensor2.setEnvironmentalData(sensor1.humidity(), sensor1.temperature());
     }
 
     if (sensor2.read()) {
+#if !AIROCAT_AGGREGATE
         sensor2.publish();
+#endif
+    }
+
+#if AIROCAT_AGGREGATE
+#if AIROCAT_EVENTS
+    if (dataSet.tripped()) {
+        /* The tripped value goes out at once instead of waiting for the rest of period */
+        aggregator.trigger();
     }
+#endif
+    aggregator.publish(sensor1, sensor2);
+#endif
+#if AIROCAT_STATISTICS
+    statistics.publish(sensor1, sensor2);
+#endif
+#if AIROCAT_HTTP_PORT
+    exporter.loop();
+#endif
+#if AIROCAT_LOG_MQTT
+    logPublish(publisher);
+#endif
+    logLoop();
+
+    scheduler.due(publisher.due());
+    scheduler.due(sensor1.due());
+    scheduler.due(sensor2.due());
+#if AIROCAT_AGGREGATE
+    scheduler.due(aggregator.due());
+#endif
+#if AIROCAT_STATISTICS
+    scheduler.due(statistics.due());
+#endif
+#if AIROCAT_DIAGNOSTICS
+    scheduler.due(diagnostics.due());
+#endif
+#if AIROCAT_HTTP_PORT
+    scheduler.due(exporter.due());
+#endif
+    scheduler.due(logDue());
 }
@@ -0,0 +1,377 @@
+/* The units under test are built into the test program with the options the tests cover */
+#undef AIROCAT_DELAY
+#define AIROCAT_DELAY 10000
+#undef AIROCAT_HEARTBEAT
+#define AIROCAT_HEARTBEAT 0
+#undef AIROCAT_EVENTS
+#define AIROCAT_EVENTS 60000
+#undef AIROCAT_STATISTICS
+#define AIROCAT_STATISTICS true
+#undef AIROCAT_STAMP
+#define AIROCAT_STAMP false
+#undef AIROCAT_BACKLOG
+#define AIROCAT_BACKLOG 0
+#undef AIROCAT_QUEUE
+#define AIROCAT_QUEUE 0
+#undef AIROCAT_WARM_BOOT
+#define AIROCAT_WARM_BOOT false
+#undef AIROCAT_HTTP_PORT
+#define AIROCAT_HTTP_PORT 0
+#undef AIROCAT_ENCODING
+#define AIROCAT_ENCODING 0
+#undef AIROCAT_DIAGNOSTICS
+#define AIROCAT_DIAGNOSTICS 0
+#undef AIROCAT_NAMESPACE
+#define AIROCAT_NAMESPACE false
+#undef AIROCAT_LOG_MQTT
+#define AIROCAT_LOG_MQTT 0
+
+#include <Simulation.hpp>
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "../../src/DataSet.cpp"
+#include "../../src/Device.cpp"
+#include "../../src/Log.cpp"
+#include "../../src/Metric.cpp"
+
+namespace {
+
+/* The messages the data set published and whether the broker takes them */
+std::vector<std::pair<std::string, float>> Messages;
+bool Online{true};
+
+Publisher Uplink;
+
+/* Publishes the due values of all metrics as both sensors do */
+void
+publish(DataSet& data)
+{
+    data.publish(Metric::Iaq, Metric::Tvoc, true);
+}
+
+/* Returns the number of messages published for the metric */
+size_t
+count(Metric metric)
+{
+    char topic[64];
+    metricTopic(metric, topic, sizeof(topic));
+    size_t count{0};
+    for (const auto& message : Messages) {
+        count += (message.first == topic) ? 1 : 0;
+    }
+    return count;
+}
+
+/* Returns the last value published for the metric */
+float
+last(Metric metric)
+{
+    char topic[64];
+    metricTopic(metric, topic, sizeof(topic));
+    for (auto message = Messages.rbegin(); message != Messages.rend(); ++message) {
+        if (message->first == topic) {
+            return message->second;
+        }
+    }
+    TEST_FAIL_MESSAGE("The metric has not been published");
+    return 0.f;
+}
+
+/* Sets the value and publishes the due ones after the time passes */
+void
+step(DataSet& data, Metric metric, float value, uint32_t elapsed)
+{
+    data.set(metric, value);
+    sim::advance(elapsed);
+    publish(data);
+}
+
+} // namespace
+
+bool
+Publisher::publish(const char* topic, const JsonDocument& json, bool retained)
+{
+    if (!Online) {
+        return false;
+    }
+    Messages.emplace_back(topic, json[DataSet::kFieldValue].as<float>());
+    return true;
+}
+
+void
+setUp()
+{
+    Messages.clear();
+    Online = true;
+    /* The intervals count from the start of the simulated time */
+    sim::advance(AIROCAT_DELAY);
+}
+
+void
+tearDown()
+{
+}
+
+void
+test_absolute_deadband()
+{
+    DataSet data{Uplink};
+    step(data, Metric::Temperature, 20.f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(1, count(Metric::Temperature));
+
+    /* The deadband of temperature is 0.1 °C from the last published value */
+    step(data, Metric::Temperature, 20.05f, AIROCAT_DELAY);
+    step(data, Metric::Temperature, 19.95f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(1, count(Metric::Temperature));
+    step(data, Metric::Temperature, 20.2f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(2, count(Metric::Temperature));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 20.2f, last(Metric::Temperature));
+
+    data.setDeadband(Metric::Temperature, 1.f);
+    step(data, Metric::Temperature, 21.f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(2, count(Metric::Temperature));
+    step(data, Metric::Temperature, 21.3f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(3, count(Metric::Temperature));
+}
+
+void
+test_relative_deadband()
+{
+    DataSet data{Uplink};
+    /* The deadband of pressure is 0.01 % of the last published value */
+    step(data, Metric::Pressure, 1000.f, AIROCAT_DELAY);
+    step(data, Metric::Pressure, 1000.05f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(1, count(Metric::Pressure));
+    step(data, Metric::Pressure, 1000.2f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(2, count(Metric::Pressure));
+}
+
+void
+test_failed_publish_is_retried()
+{
+    DataSet data{Uplink};
+    Online = false;
+    step(data, Metric::Temperature, 20.f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(0, count(Metric::Temperature));
+
+    Online = true;
+    step(data, Metric::Temperature, 20.f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(1, count(Metric::Temperature));
+}
+
+void
+test_interval()
+{
+    DataSet data{Uplink};
+    data.setInterval(Metric::Co2, 3 * AIROCAT_DELAY);
+    step(data, Metric::Co2, 400.f, 3 * AIROCAT_DELAY);
+    step(data, Metric::Temperature, 20.f, 0);
+    TEST_ASSERT_EQUAL(1, count(Metric::Co2));
+    TEST_ASSERT_EQUAL(1, count(Metric::Temperature));
+
+    /* The changed value waits for its interval, other metrics keep their own */
+    step(data, Metric::Co2, 500.f, AIROCAT_DELAY);
+    step(data, Metric::Temperature, 21.f, 0);
+    TEST_ASSERT_EQUAL(1, count(Metric::Co2));
+    TEST_ASSERT_EQUAL(2, count(Metric::Temperature));
+    step(data, Metric::Co2, 500.f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(1, count(Metric::Co2));
+    step(data, Metric::Co2, 500.f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(2, count(Metric::Co2));
+}
+
+void
+test_period_is_shortest_interval()
+{
+    DataSet data{Uplink};
+    TEST_ASSERT_EQUAL_UINT32(AIROCAT_DELAY, data.period());
+    for (uint8_t index = 0; index < kMetricCount; ++index) {
+        data.setInterval(static_cast<Metric>(index), 60000);
+    }
+    data.setInterval(Metric::Humidity, 2000);
+    TEST_ASSERT_EQUAL_UINT32(2000, data.period());
+}
+
+void
+test_heartbeat()
+{
+    DataSet data{Uplink};
+    data.setHeartbeat(6 * AIROCAT_DELAY);
+    step(data, Metric::Temperature, 20.f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(1, count(Metric::Temperature));
+    for (int i = 0; i < 5; ++i) {
+        step(data, Metric::Temperature, 20.f, AIROCAT_DELAY);
+    }
+    TEST_ASSERT_EQUAL(1, count(Metric::Temperature));
+    /* The unchanged value is republished once the heartbeat passes */
+    step(data, Metric::Temperature, 20.f, AIROCAT_DELAY);
+    TEST_ASSERT_EQUAL(2, count(Metric::Temperature));
+}
+
+void
+test_refresh_publishes_unchanged_values()
+{
+    DataSet data{Uplink};
+    step(data, Metric::Temperature, 20.f, AIROCAT_DELAY);
+    data.refresh();
+    publish(data);
+    TEST_ASSERT_EQUAL(2, count(Metric::Temperature));
+}
+
+void
+test_event_trips_before_interval()
+{
+    DataSet data{Uplink};
+    data.setInterval(Metric::Co2, 600000);
+    data.refresh();
+    step(data, Metric::Co2, 400.f, 1000);
+    TEST_ASSERT_EQUAL(1, count(Metric::Co2));
+
+    /* The steady readings settle the averages */
+    for (int i = 0; i < 300; ++i) {
+        step(data, Metric::Co2, 400.f + static_cast<float>(i % 3) * 5.f, 1000);
+    }
+    TEST_ASSERT_FALSE(data.tripped());
+    TEST_ASSERT_EQUAL(1, count(Metric::Co2));
+
+    /* The sudden rise goes out at once */
+    data.set(Metric::Co2, 1500.f);
+    TEST_ASSERT_TRUE(data.tripped());
+    publish(data);
+    TEST_ASSERT_EQUAL(2, count(Metric::Co2));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 1500.f, last(Metric::Co2));
+
+    /* While the threshold stays exceeded the value waits for the interval again */
+    for (int i = 0; i < 10; ++i) {
+        step(data, Metric::Co2, 1600.f + static_cast<float>(i) * 50.f, 1000);
+    }
+    TEST_ASSERT_FALSE(data.tripped());
+    TEST_ASSERT_EQUAL(2, count(Metric::Co2));
+}
+
+void
+test_event_rate_limited()
+{
+    DataSet data{Uplink};
+    data.setInterval(Metric::Co2, 600000);
+    data.refresh();
+    for (int i = 0; i < 300; ++i) {
+        step(data, Metric::Co2, 400.f, 1000);
+    }
+    step(data, Metric::Co2, 1500.f, 1000);
+    TEST_ASSERT_EQUAL(2, count(Metric::Co2));
+    const auto alerted = millis();
+
+    /* The value drops back and rises again, the second event is held until AIROCAT_EVENTS passes */
+    for (int i = 0; i < 40; ++i) {
+        step(data, Metric::Co2, 400.f, 1000);
+    }
+    while (count(Metric::Co2) == 2 && millis() - alerted < 2 * AIROCAT_EVENTS) {
+        step(data, Metric::Co2, 2500.f, 1000);
+    }
+    TEST_ASSERT_EQUAL(3, count(Metric::Co2));
+    TEST_ASSERT_TRUE(millis() - alerted >= AIROCAT_EVENTS);
+    TEST_ASSERT_TRUE(millis() - alerted <= AIROCAT_EVENTS + 1000);
+}
+
+void
+test_event_disabled()
+{
+    DataSet data{Uplink};
+    data.setInterval(Metric::Co2, 600000);
+    data.setEvent(Metric::Co2, 0.f, 0.f);
+    data.refresh();
+    for (int i = 0; i < 300; ++i) {
+        step(data, Metric::Co2, 400.f, 1000);
+    }
+    step(data, Metric::Co2, 1500.f, 1000);
+    TEST_ASSERT_FALSE(data.tripped());
+    TEST_ASSERT_EQUAL(1, count(Metric::Co2));
+}
+
+void
+test_statistics_window()
+{
+    DataSet data{Uplink};
+    for (const auto value : {2.f, 4.f, 4.f, 4.f, 5.f, 5.f, 7.f, 9.f}) {
+        data.set(Metric::Temperature, value);
+    }
+    StaticJsonDocument<JSON_OBJECT_SIZE(kMetricCount) + kMetricCount * JSON_ARRAY_SIZE(5)> json;
+    JsonObject state = json.to<JsonObject>();
+    data.summarize(state, Metric::Temperature, Metric::Temperature, true);
+
+    /* [min, mean, max, sample standard deviation, count] */
+    JsonArray values = state["temperature"];
+    TEST_ASSERT_EQUAL(5, values.size());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.f, values[0].as<float>());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 5.f, values[1].as<float>());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 9.f, values[2].as<float>());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.14f, values[3].as<float>());
+    TEST_ASSERT_EQUAL(8, values[4].as<int>());
+
+    /* The next window starts empty */
+    state = json.to<JsonObject>();
+    data.summarize(state, Metric::Temperature, Metric::Temperature, true);
+    TEST_ASSERT_EQUAL(0, state.size());
+}
+
+void
+test_statistics_large_offset()
+{
+    /* The streaming update keeps the deviation of values far from zero,
+       the naive sum of squares loses it in float */
+    DataSet data{Uplink};
+    for (int i = 0; i < 1000; ++i) {
+        data.set(Metric::GasResistance, 100000.f + ((i % 2 == 0) ? -1.f : 1.f));
+    }
+    StaticJsonDocument<JSON_OBJECT_SIZE(kMetricCount) + kMetricCount * JSON_ARRAY_SIZE(5)> json;
+    JsonObject state = json.to<JsonObject>();
+    data.summarize(state, Metric::GasResistance, Metric::GasResistance, true);
+
+    JsonArray values = state["gasResistance"];
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 100000.f, values[1].as<float>());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.f, values[3].as<float>());
+    TEST_ASSERT_EQUAL(1000, values[4].as<int>());
+}
+
+void
+test_statistics_single_value_and_gated()
+{
+    DataSet data{Uplink};
+    data.set(Metric::Humidity, 40.f);
+    data.set(Metric::Iaq, 50.f);
+    StaticJsonDocument<JSON_OBJECT_SIZE(kMetricCount) + kMetricCount * JSON_ARRAY_SIZE(5)> json;
+    JsonObject state = json.to<JsonObject>();
+    /* The gated metric is left out before stabilization, its window is dropped as well */
+    data.summarize(state, Metric::Iaq, Metric::Humidity, false);
+    TEST_ASSERT_FALSE(state.containsKey("iaq"));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.f, state["humidity"][3].as<float>());
+    TEST_ASSERT_EQUAL(1, state["humidity"][4].as<int>());
+
+    state = json.to<JsonObject>();
+    data.summarize(state, Metric::Iaq, Metric::Humidity, true);
+    TEST_ASSERT_EQUAL(0, state.size());
+}
+
+int
+main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_absolute_deadband);
+    RUN_TEST(test_relative_deadband);
+    RUN_TEST(test_failed_publish_is_retried);
+    RUN_TEST(test_interval);
+    RUN_TEST(test_period_is_shortest_interval);
+    RUN_TEST(test_heartbeat);
+    RUN_TEST(test_refresh_publishes_unchanged_values);
+    RUN_TEST(test_event_trips_before_interval);
+    RUN_TEST(test_event_rate_limited);
+    RUN_TEST(test_event_disabled);
+    RUN_TEST(test_statistics_window);
+    RUN_TEST(test_statistics_large_offset);
+    RUN_TEST(test_statistics_single_value_and_gated);
+    return UNITY_END();
+}
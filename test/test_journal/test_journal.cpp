@@ -0,0 +1,223 @@
+/* The unit under test is built into the test program, so it does not depend on conf/config.ini */
+#undef AIROCAT_LOG_MQTT
+#define AIROCAT_LOG_MQTT 0
+
+#include <LittleFS.h>
+#include <unity.h>
+
+#include "../../src/Journal.cpp"
+#include "../../src/Log.cpp"
+
+namespace {
+
+const char* kPrefix = "/test";
+/* The size of copy header: magic, sequence number, size and CRC of the record */
+constexpr const auto kHeaderSize = size_t{16};
+
+struct Record {
+    uint32_t value;
+    char name[12];
+};
+
+Record
+record(uint32_t value)
+{
+    Record data{value, {}};
+    snprintf(data.name, sizeof(data.name), "record%u", static_cast<unsigned>(value));
+    return data;
+}
+
+bool
+save(Journal& journal, uint32_t value)
+{
+    const auto data = record(value);
+    return journal.save(reinterpret_cast<const uint8_t*>(&data), sizeof(data));
+}
+
+/* Loads the record as the next boot does, returns 0 if there is no valid copy */
+uint32_t
+load()
+{
+    Journal journal{kPrefix};
+    Record data{};
+    if (!journal.load(reinterpret_cast<uint8_t*>(&data), sizeof(data))) {
+        return 0;
+    }
+    TEST_ASSERT_EQUAL_STRING(record(data.value).name, data.name);
+    return data.value;
+}
+
+void
+slotPath(uint8_t slot, char* name, size_t size)
+{
+    snprintf(name, size, "%s%u.bin", kPrefix, slot);
+}
+
+/* Flips the byte of the slot file as a worn out flash cell would */
+void
+corrupt(uint8_t slot, size_t offset)
+{
+    char name[32];
+    slotPath(slot, name, sizeof(name));
+    File file = LittleFS.open(name, "r+");
+    TEST_ASSERT_TRUE(static_cast<bool>(file));
+    uint8_t byte;
+    TEST_ASSERT_TRUE(file.seek(offset));
+    TEST_ASSERT_EQUAL(1, file.read(&byte, 1));
+    byte ^= 0xFF;
+    TEST_ASSERT_TRUE(file.seek(offset));
+    TEST_ASSERT_EQUAL(1, file.write(&byte, 1));
+    file.close();
+}
+
+/* Cuts the slot file as a power loss in the middle of save would */
+void
+truncate(uint8_t slot, size_t size)
+{
+    char name[32];
+    slotPath(slot, name, sizeof(name));
+    File file = LittleFS.open(name, "r");
+    TEST_ASSERT_TRUE(static_cast<bool>(file));
+    uint8_t data[64];
+    TEST_ASSERT_TRUE(size <= sizeof(data));
+    TEST_ASSERT_EQUAL(size, file.read(data, size));
+    file.close();
+    file = LittleFS.open(name, "w");
+    TEST_ASSERT_EQUAL(size, file.write(data, size));
+    file.close();
+}
+
+} // namespace
+
+void
+setUp()
+{
+    LittleFS.format();
+}
+
+void
+tearDown()
+{
+}
+
+void
+test_load_without_copies()
+{
+    TEST_ASSERT_EQUAL(0, load());
+}
+
+void
+test_saves_rotate_over_slots()
+{
+    Journal journal{kPrefix};
+    char name[32];
+
+    TEST_ASSERT_TRUE(save(journal, 1));
+    slotPath(0, name, sizeof(name));
+    TEST_ASSERT_TRUE(LittleFS.exists(name));
+    slotPath(1, name, sizeof(name));
+    TEST_ASSERT_FALSE(LittleFS.exists(name));
+
+    TEST_ASSERT_TRUE(save(journal, 2));
+    TEST_ASSERT_TRUE(LittleFS.exists(name));
+    TEST_ASSERT_EQUAL(2, load());
+}
+
+void
+test_load_picks_newest_copy()
+{
+    Journal journal{kPrefix};
+    for (uint32_t value = 1; value <= 5; ++value) {
+        TEST_ASSERT_TRUE(save(journal, value));
+        /* The newest copy alternates between the slots */
+        TEST_ASSERT_EQUAL(value, load());
+    }
+}
+
+void
+test_save_after_load_keeps_newest_copy()
+{
+    {
+        Journal journal{kPrefix};
+        TEST_ASSERT_TRUE(save(journal, 1));
+        TEST_ASSERT_TRUE(save(journal, 2));
+        TEST_ASSERT_TRUE(save(journal, 3));
+    }
+    /* The next boot continues the sequence and overwrites the older copy only */
+    Journal journal{kPrefix};
+    Record data{};
+    TEST_ASSERT_TRUE(journal.load(reinterpret_cast<uint8_t*>(&data), sizeof(data)));
+    TEST_ASSERT_TRUE(save(journal, 4));
+    TEST_ASSERT_EQUAL(4, load());
+    corrupt(1, kHeaderSize + 4);
+    TEST_ASSERT_EQUAL(3, load());
+}
+
+void
+test_corrupted_copy_falls_back_to_previous()
+{
+    Journal journal{kPrefix};
+    TEST_ASSERT_TRUE(save(journal, 1));
+    TEST_ASSERT_TRUE(save(journal, 2));
+
+    /* The last byte of the record fails the CRC of the newest copy */
+    corrupt(1, kHeaderSize + sizeof(Record) - 1);
+    TEST_ASSERT_EQUAL(1, load());
+}
+
+void
+test_torn_write_falls_back_to_previous()
+{
+    Journal journal{kPrefix};
+    TEST_ASSERT_TRUE(save(journal, 1));
+    TEST_ASSERT_TRUE(save(journal, 2));
+
+    truncate(1, kHeaderSize / 2);
+    TEST_ASSERT_EQUAL(1, load());
+}
+
+void
+test_save_replaces_corrupted_copy()
+{
+    {
+        Journal journal{kPrefix};
+        TEST_ASSERT_TRUE(save(journal, 1));
+        TEST_ASSERT_TRUE(save(journal, 2));
+    }
+    corrupt(1, kHeaderSize + 4);
+
+    Journal journal{kPrefix};
+    Record data{};
+    TEST_ASSERT_TRUE(journal.load(reinterpret_cast<uint8_t*>(&data), sizeof(data)));
+    TEST_ASSERT_EQUAL(1, data.value);
+    /* The save goes to the slot of the corrupted copy, the valid one stays as the fallback */
+    TEST_ASSERT_TRUE(save(journal, 3));
+    TEST_ASSERT_EQUAL(3, load());
+    corrupt(1, kHeaderSize + 4);
+    TEST_ASSERT_EQUAL(1, load());
+}
+
+void
+test_record_of_other_size_is_ignored()
+{
+    Journal journal{kPrefix};
+    TEST_ASSERT_TRUE(save(journal, 1));
+
+    uint8_t data[sizeof(Record) + 4];
+    TEST_ASSERT_FALSE(Journal{kPrefix}.load(data, sizeof(data)));
+}
+
+int
+main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_load_without_copies);
+    RUN_TEST(test_saves_rotate_over_slots);
+    RUN_TEST(test_load_picks_newest_copy);
+    RUN_TEST(test_save_after_load_keeps_newest_copy);
+    RUN_TEST(test_corrupted_copy_falls_back_to_previous);
+    RUN_TEST(test_torn_write_falls_back_to_previous);
+    RUN_TEST(test_save_replaces_corrupted_copy);
+    RUN_TEST(test_record_of_other_size_is_ignored);
+    return UNITY_END();
+}
@@ -0,0 +1,147 @@
+/* The unit under test is built into the test program with the options the tests cover */
+#undef AIROCAT_QUEUE
+#define AIROCAT_QUEUE 64
+#undef AIROCAT_ENCODING
+#define AIROCAT_ENCODING 0
+
+#include <ArduinoJson.h>
+#include <unity.h>
+
+#include "../../src/Outbox.cpp"
+
+namespace {
+
+/* Pushes {"value": <n>} to the topic */
+bool
+push(Outbox& outbox, const char* topic, int value)
+{
+    StaticJsonDocument<JSON_OBJECT_SIZE(1)> json;
+    json["value"] = value;
+    return outbox.push(topic, json, false);
+}
+
+void
+expectFront(const Outbox& outbox, const char* topic, int value)
+{
+    char payload[16];
+    snprintf(payload, sizeof(payload), "{\"value\":%d}", value);
+
+    Outbox::Message message{};
+    TEST_ASSERT_TRUE(outbox.front(message));
+    TEST_ASSERT_EQUAL_STRING(topic, message.topic);
+    TEST_ASSERT_EQUAL(strlen(payload), message.length);
+    TEST_ASSERT_EQUAL_MEMORY(payload, message.payload, message.length);
+    TEST_ASSERT_FALSE(message.retained);
+}
+
+/* Fills the queue, returns the number of accepted messages */
+size_t
+fill(Outbox& outbox)
+{
+    size_t count{0};
+    while (push(outbox, "airocat/co2", static_cast<int>(count))) {
+        count++;
+    }
+    return count;
+}
+
+} // namespace
+
+void
+setUp()
+{
+}
+
+void
+tearDown()
+{
+}
+
+void
+test_messages_go_out_in_order()
+{
+    Outbox outbox;
+    TEST_ASSERT_TRUE(outbox.empty());
+    TEST_ASSERT_TRUE(push(outbox, "airocat/co2", 1));
+    TEST_ASSERT_TRUE(push(outbox, "airocat/tvoc", 2));
+    TEST_ASSERT_EQUAL(2, outbox.count());
+
+    expectFront(outbox, "airocat/co2", 1);
+    outbox.pop();
+    expectFront(outbox, "airocat/tvoc", 2);
+    outbox.pop();
+    TEST_ASSERT_TRUE(outbox.empty());
+    TEST_ASSERT_EQUAL(0, outbox.size());
+    TEST_ASSERT_EQUAL(0, outbox.rejected());
+}
+
+void
+test_full_queue_rejects_new_message()
+{
+    Outbox outbox;
+    const auto accepted = fill(outbox);
+    TEST_ASSERT_GREATER_THAN(0, accepted);
+    TEST_ASSERT_EQUAL(accepted, outbox.count());
+    TEST_ASSERT_LESS_OR_EQUAL(AIROCAT_QUEUE, outbox.size());
+    TEST_ASSERT_EQUAL(1, outbox.rejected());
+
+    TEST_ASSERT_FALSE(push(outbox, "airocat/co2", 9));
+    TEST_ASSERT_EQUAL(2, outbox.rejected());
+    TEST_ASSERT_EQUAL(accepted, outbox.count());
+}
+
+void
+test_rejection_keeps_accepted_messages()
+{
+    Outbox outbox;
+    const auto accepted = fill(outbox);
+    TEST_ASSERT_FALSE(push(outbox, "airocat/temperature", 9));
+
+    /* Every message the caller was told about goes out intact */
+    for (size_t value = 0; value < accepted; ++value) {
+        expectFront(outbox, "airocat/co2", static_cast<int>(value));
+        outbox.pop();
+    }
+    TEST_ASSERT_TRUE(outbox.empty());
+}
+
+void
+test_pop_makes_room()
+{
+    Outbox outbox;
+    const auto accepted = fill(outbox);
+    const auto size = outbox.size();
+
+    outbox.pop();
+    TEST_ASSERT_TRUE(push(outbox, "airocat/co2", 7));
+    TEST_ASSERT_EQUAL(accepted, outbox.count());
+    TEST_ASSERT_EQUAL(size, outbox.size());
+    TEST_ASSERT_EQUAL(size, outbox.peak());
+    expectFront(outbox, "airocat/co2", 1);
+}
+
+void
+test_oversized_message_is_rejected()
+{
+    Outbox outbox;
+    char topic[AIROCAT_QUEUE];
+    memset(topic, 'a', sizeof(topic) - 1);
+    topic[sizeof(topic) - 1] = '\0';
+
+    TEST_ASSERT_FALSE(push(outbox, topic, 1));
+    TEST_ASSERT_EQUAL(1, outbox.rejected());
+    TEST_ASSERT_TRUE(outbox.empty());
+    TEST_ASSERT_EQUAL(0, outbox.peak());
+}
+
+int
+main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_messages_go_out_in_order);
+    RUN_TEST(test_full_queue_rejects_new_message);
+    RUN_TEST(test_rejection_keeps_accepted_messages);
+    RUN_TEST(test_pop_makes_room);
+    RUN_TEST(test_oversized_message_is_rejected);
+    return UNITY_END();
+}
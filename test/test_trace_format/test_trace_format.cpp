@@ -0,0 +1,215 @@
+#include <TraceFormat.h>
+#include <unity.h>
+
+#include <vector>
+
+namespace {
+
+trace::Sample
+bme680(uint32_t time, float base)
+{
+    trace::Sample sample{trace::Source::Bme680, time, {}};
+    for (uint8_t i = 0; i < trace::Bme680FieldCount; ++i) {
+        sample.fields[i] = base * (i + 1);
+    }
+    return sample;
+}
+
+trace::Sample
+ccs811(uint32_t time, float co2, float tvoc)
+{
+    trace::Sample sample{trace::Source::Ccs811, time, {}};
+    sample.fields[trace::Co2] = co2;
+    sample.fields[trace::Tvoc] = tvoc;
+    return sample;
+}
+
+/* Encodes the samples into a single stream */
+std::vector<uint8_t>
+encode(trace::Encoder& encoder, const std::vector<trace::Sample>& samples)
+{
+    std::vector<uint8_t> data;
+    uint8_t buffer[trace::kEncodedMax];
+    for (const auto& sample : samples) {
+        const auto size = encoder.encode(sample, buffer);
+        TEST_ASSERT_LESS_OR_EQUAL(trace::kEncodedMax, size);
+        data.insert(data.end(), buffer, buffer + size);
+    }
+    return data;
+}
+
+std::vector<trace::Sample>
+decode(const std::vector<uint8_t>& data)
+{
+    std::vector<trace::Sample> samples;
+    trace::Decoder decoder;
+    trace::Sample sample{};
+    const uint8_t* position = data.data();
+    while (decoder.next(position, data.data() + data.size(), sample)) {
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+/* The decoded fields are the readings at the resolution of the trace */
+void
+expectSample(const trace::Sample& expected, const trace::Sample& actual)
+{
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(expected.source), static_cast<uint8_t>(actual.source));
+    TEST_ASSERT_EQUAL_UINT32(expected.time, actual.time);
+    const float* scale = trace::scales(expected.source);
+    for (uint8_t i = 0; i < trace::fieldCount(expected.source); ++i) {
+        TEST_ASSERT_FLOAT_WITHIN(0.5f / scale[i], expected.fields[i], actual.fields[i]);
+    }
+}
+
+} // namespace
+
+void
+setUp()
+{
+}
+
+void
+tearDown()
+{
+}
+
+void
+test_samples_round_trip()
+{
+    /* The values go up and down, so the deltas of both signs and of several bytes are encoded */
+    std::vector<trace::Sample> samples;
+    uint32_t time{1000};
+    for (int i = 0; i < 600; ++i) {
+        const float swing = (i % 7 < 3) ? -1.f : 1.f;
+        samples.push_back(bme680(time, 25.f + swing * static_cast<float>(i % 50) * 13.7f));
+        const float co2 = 400.f + swing * static_cast<float>(i * 31 % 4000);
+        samples.push_back(ccs811(time + 3, co2, static_cast<float>(i % 3)));
+        time += (i % 10 == 0) ? 70000 : 1000;
+    }
+    trace::Encoder encoder;
+    const auto decoded = decode(encode(encoder, samples));
+    TEST_ASSERT_EQUAL(samples.size(), decoded.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        expectSample(samples[i], decoded[i]);
+    }
+}
+
+void
+test_extreme_values_round_trip()
+{
+    /* The deltas of both signs take five byte varints */
+    const std::vector<trace::Sample> samples = {
+        ccs811(0, 1e9f, -1e9f),
+        ccs811(1, -1e9f, 1e9f),
+        ccs811(UINT32_MAX / 2, 0.f, -1.f),
+        ccs811(UINT32_MAX / 2 + 1, -1.f, 0.f),
+    };
+    trace::Encoder encoder;
+    const auto decoded = decode(encode(encoder, samples));
+    TEST_ASSERT_EQUAL(samples.size(), decoded.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        TEST_ASSERT_EQUAL_UINT32(samples[i].time, decoded[i].time);
+        TEST_ASSERT_EQUAL_FLOAT(samples[i].fields[trace::Co2], decoded[i].fields[trace::Co2]);
+        TEST_ASSERT_EQUAL_FLOAT(samples[i].fields[trace::Tvoc], decoded[i].fields[trace::Tvoc]);
+    }
+}
+
+void
+test_small_deltas_take_byte_each()
+{
+    trace::Encoder encoder;
+    uint8_t buffer[trace::kEncodedMax];
+    /* The first record is preceded by sync record: source and time 300 as two byte varint */
+    TEST_ASSERT_EQUAL(3 + 1 + 1 + 2, encoder.encode(ccs811(300, 1.f, 0.f), buffer));
+    const uint8_t first[] = {0, 0xAC, 0x02, 2, 0, 0x02, 0x00};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(first, buffer, sizeof(first));
+
+    /* The decrease by 1 is zigzag 1, the increase by 1 is zigzag 2 */
+    TEST_ASSERT_EQUAL(4, encoder.encode(ccs811(400, 0.f, 1.f), buffer));
+    const uint8_t second[] = {2, 100, 0x01, 0x02};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(second, buffer, sizeof(second));
+}
+
+void
+test_sync_record_repeats()
+{
+    trace::Encoder encoder;
+    uint8_t buffer[trace::kEncodedMax];
+    size_t synced{0};
+    for (uint32_t i = 0; i < 3 * trace::kSyncPeriod; ++i) {
+        encoder.encode(ccs811(i * 1000, 400.f, 0.f), buffer);
+        if (buffer[0] == static_cast<uint8_t>(trace::Source::Sync)) {
+            TEST_ASSERT_EQUAL(0, i % trace::kSyncPeriod);
+            synced++;
+        }
+    }
+    TEST_ASSERT_EQUAL(3, synced);
+}
+
+void
+test_decoding_starts_at_sync_record()
+{
+    std::vector<trace::Sample> samples;
+    for (uint32_t i = 0; i < trace::kSyncPeriod + 10; ++i) {
+        samples.push_back(ccs811(i * 1000, 400.f + static_cast<float>(i), 0.f));
+    }
+    trace::Encoder encoder;
+    const auto head = encode(encoder, {samples.begin(), samples.begin() + trace::kSyncPeriod});
+    /* The capture starting in the middle of the stream is decoded from the next sync record */
+    const auto tail = encode(encoder, {samples.begin() + trace::kSyncPeriod, samples.end()});
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(trace::Source::Sync), tail.front());
+    TEST_ASSERT_TRUE(decode(head).size() == trace::kSyncPeriod);
+
+    const auto decoded = decode(tail);
+    TEST_ASSERT_EQUAL(10, decoded.size());
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        expectSample(samples[trace::kSyncPeriod + i], decoded[i]);
+    }
+}
+
+void
+test_reboot_keeps_time_growing()
+{
+    trace::Encoder before;
+    auto data = encode(before, {bme680(50000, 1.f), bme680(60000, 2.f)});
+    /* The encoder of the next boot starts with sync record at the time since the new boot */
+    trace::Encoder after;
+    const auto rebooted = encode(after, {bme680(2000, 3.f), bme680(3000, 4.f)});
+    data.insert(data.end(), rebooted.begin(), rebooted.end());
+
+    /* The time going back at sync record is shifted to continue from the last sample */
+    const auto decoded = decode(data);
+    TEST_ASSERT_EQUAL(4, decoded.size());
+    TEST_ASSERT_EQUAL_UINT32(60000, decoded[1].time);
+    TEST_ASSERT_EQUAL_UINT32(60000, decoded[2].time);
+    TEST_ASSERT_EQUAL_UINT32(61000, decoded[3].time);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 4.f, decoded[3].fields[trace::RawTemperature]);
+}
+
+void
+test_truncated_record_stops_decoding()
+{
+    trace::Encoder encoder;
+    auto data = encode(encoder, {bme680(1000, 1000.f), bme680(2000, 2000.f)});
+    data.pop_back();
+
+    const auto decoded = decode(data);
+    TEST_ASSERT_EQUAL(1, decoded.size());
+    expectSample(bme680(1000, 1000.f), decoded[0]);
+}
+
+int
+main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_samples_round_trip);
+    RUN_TEST(test_extreme_values_round_trip);
+    RUN_TEST(test_small_deltas_take_byte_each);
+    RUN_TEST(test_sync_record_repeats);
+    RUN_TEST(test_decoding_starts_at_sync_record);
+    RUN_TEST(test_reboot_keeps_time_growing);
+    RUN_TEST(test_truncated_record_stops_decoding);
+    return UNITY_END();
+}
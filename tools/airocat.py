@@ -0,0 +1,509 @@
+#!/usr/bin/env python3
+"""Host-side helper for airocat payloads.
+
+Commands:
+  decode   subscribe to airocat topics and print decoded payloads (JSON or MessagePack)
+  compare  print payload and MQTT frame sizes of JSON and MessagePack encodings
+  fleet    run many simulated devices (native build) against a broker and measure the load
+  latency  report sensor-to-host latency histograms and loss rate of stamped messages
+  trace    convert serial capture of raw readings into trace file, print its summary or samples
+
+Requires `msgpack` and (for decode, fleet and latency) `paho-mqtt` packages.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import threading
+import time
+
+import msgpack
+
+# The metric identifiers (keep in sync with src/Metric.hpp and src/Metric.cpp)
+METRICS = [
+    # (key, caption, sample value)
+    ("iaq", "IAQ", 52.37),
+    ("co2Eq", "CO2 (equivalent)", 612.5),
+    ("breathVocEq", "BreathVoc (equivalent)", 0.87),
+    ("temperature", "Temperature, °C", 23.14),
+    ("humidity", "Humidity, %", 41.62),
+    ("pressure", "Pressure, hPa", 100123.0),
+    ("gasResistance", "Gar (resistance), Ohm", 145322.0),
+    ("gasPercentage", "Gar (percentage), %", 64.2),
+    ("initialStabStatus", "Initial stabilization status", 1.0),
+    ("powerOnStabStatus", "Power-on stabilization status", 1.0),
+    ("co2", "CO2, ppm", 640),
+    ("tvoc", "TVOC, ppb", 36),
+]
+
+
+def decode(payload):
+    """Decodes payload of any encoding into a dictionary or a list"""
+    try:
+        value = json.loads(payload)
+    except (UnicodeDecodeError, ValueError):
+        value = msgpack.unpackb(payload)
+    # The compact form of single value: [<metric id>, <value>] or, stamped,
+    # [<metric id>, <value>, <seq>, <acquired>, <published>]
+    if isinstance(value, list) and len(value) in (2, 5) and isinstance(value[0], int):
+        metric = value[0]
+        if 0 <= metric < len(METRICS):
+            result = {"metric": METRICS[metric][0], "value": value[1]}
+            if len(value) == 5:
+                result.update(seq=value[2], time=value[3:])
+            return result
+    return value
+
+
+def frame_size(topic, payload):
+    """Returns the size of MQTT PUBLISH packet (QoS 0) carrying the payload"""
+    remaining = 2 + len(topic) + len(payload)
+    header = 2 if remaining < 128 else 3
+    return header + remaining
+
+
+def run_compare(_):
+    print(f"{'metric':<20} {'json':>6} {'msgpack':>8} {'json frame':>11} {'msgpack frame':>14}")
+    totals = [0, 0, 0, 0]
+    for metric, (key, caption, value) in enumerate(METRICS):
+        topic = f"airocat/{key}"
+        as_json = json.dumps({"caption": caption, "value": value},
+                             ensure_ascii=False, separators=(",", ":")).encode()
+        as_msgpack = msgpack.packb([metric, float(value) if isinstance(value, float) else value],
+                                   use_single_float=True)
+        sizes = [len(as_json), len(as_msgpack),
+                 frame_size(topic, as_json), frame_size(topic, as_msgpack)]
+        totals = [t + s for t, s in zip(totals, sizes)]
+        print(f"{key:<20} {sizes[0]:>6} {sizes[1]:>8} {sizes[2]:>11} {sizes[3]:>14}")
+    print(f"{'total':<20} {totals[0]:>6} {totals[1]:>8} {totals[2]:>11} {totals[3]:>14}")
+
+    state = {key: value for key, _, value in METRICS}
+    as_json = json.dumps(state, separators=(",", ":")).encode()
+    as_msgpack = msgpack.packb(state, use_single_float=True)
+    print(f"{'state (aggregate)':<20} {len(as_json):>6} {len(as_msgpack):>8} "
+          f"{frame_size('airocat/state', as_json):>11} {frame_size('airocat/state', as_msgpack):>14}")
+
+
+def connect(mqtt, args):
+    """Returns the client connected to the broker given in arguments"""
+    try:
+        client = mqtt.Client(mqtt.CallbackAPIVersion.VERSION2)
+    except AttributeError:
+        # paho-mqtt before 2.0
+        client = mqtt.Client()
+    if args.user:
+        client.username_pw_set(args.user, args.password)
+    return client
+
+
+def run_decode(args):
+    import paho.mqtt.client as mqtt
+
+    def on_connect(client, *_):
+        client.subscribe(f"{args.prefix}/#")
+
+    def on_message(_, __, message):
+        try:
+            value = decode(message.payload)
+        except Exception as error:
+            value = f"<undecodable: {error}>"
+        print(f"{message.topic} ({len(message.payload)} bytes): {value}", flush=True)
+
+    client = connect(mqtt, args)
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.host, args.port)
+    client.loop_forever()
+
+
+def cpu_seconds(pid):
+    """Returns user and system CPU time of the process in seconds"""
+    with open(f"/proc/{pid}/stat") as stat:
+        # The command name in parentheses might contain spaces
+        fields = stat.read().rsplit(")", 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def find_pid(name):
+    """Returns the PID of the first process with the name or None"""
+    for entry in os.listdir("/proc"):
+        if entry.isdigit():
+            try:
+                with open(f"/proc/{entry}/comm") as comm:
+                    if comm.read().strip() == name:
+                        return int(entry)
+            except OSError:
+                pass
+    return None
+
+
+def run_fleet(args):
+    import paho.mqtt.client as mqtt
+
+    # The broker statistics published by mosquitto (sys_interval might need to be lowered)
+    sys_topics = {
+        "$SYS/broker/clients/connected": "clients",
+        "$SYS/broker/load/messages/received/1min": "received/min",
+        "$SYS/broker/load/messages/sent/1min": "sent/min",
+    }
+    lock = threading.Lock()
+    counters = {"messages": 0, "bytes": 0}
+    broker = {}
+
+    def on_connect(client, *_):
+        # Subscribes as HomeAssistant does: discovery configs and state topics of all devices
+        client.subscribe([(f"{args.prefix}/#", 0), ("homeassistant/#", 0)] + [(t, 0) for t in sys_topics])
+
+    def on_message(_, __, message):
+        with lock:
+            if message.topic in sys_topics:
+                broker[sys_topics[message.topic]] = message.payload.decode()
+            else:
+                counters["messages"] += 1
+                counters["bytes"] += len(message.payload)
+
+    client = connect(mqtt, args)
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.host, args.port)
+    client.loop_start()
+
+    pid = args.broker_pid or find_pid("mosquitto")
+    if pid is None:
+        print("Broker process is not found, its CPU usage is not reported", file=sys.stderr)
+
+    devices = []
+    # The devices outlive the measurement and are stopped once it is over
+    days = (args.duration + args.ramp + 60) / 86400
+    try:
+        for index in range(args.devices):
+            command = [args.program, "--realtime", "--days", f"{days:.6f}", "--broker", args.host,
+                       "--broker-port", str(args.port), "--chip-id", str(args.chip_base + index),
+                       "--seed", str(index + 1)]
+            devices.append(subprocess.Popen(command, stdout=subprocess.DEVNULL))
+            # Spread the connects to not measure the reconnect storm unless asked to
+            if args.ramp > 0:
+                time.sleep(args.ramp / args.devices)
+
+        print(f"{'time':>6} {'msgs/s':>8} {'bytes/s':>10} {'cpu %':>6}  broker")
+        start = time.monotonic()
+        totals = {"messages": 0, "bytes": 0, "cpu": 0.}
+        previous_cpu = cpu_seconds(pid) if pid else 0.
+        while time.monotonic() - start < args.duration and any(d.poll() is None for d in devices):
+            time.sleep(args.interval)
+            with lock:
+                messages, counters["messages"] = counters["messages"], 0
+                size, counters["bytes"] = counters["bytes"], 0
+                stats = " ".join(f"{k}={v}" for k, v in broker.items())
+            cpu = cpu_seconds(pid) if pid else 0.
+            usage, previous_cpu = (cpu - previous_cpu) / args.interval * 100, cpu
+            totals["messages"] += messages
+            totals["bytes"] += size
+            totals["cpu"] += usage * args.interval
+            print(f"{time.monotonic() - start:>6.0f} {messages / args.interval:>8.1f} "
+                  f"{size / args.interval:>10.1f} {usage:>6.1f}  {stats}", flush=True)
+
+        elapsed = time.monotonic() - start
+        print(f"\n{args.devices} devices, {elapsed:.0f} s: {totals['messages'] / elapsed:.1f} msgs/s, "
+              f"{totals['bytes'] / elapsed:.1f} bytes/s, broker CPU {totals['cpu'] / elapsed:.1f} %, "
+              f"{totals['messages'] / elapsed / args.devices:.2f} msgs/s per device")
+    finally:
+        for device in devices:
+            device.terminate()
+        for device in devices:
+            device.wait()
+        client.loop_stop()
+
+
+# The upper bounds (ms) of latency histogram buckets
+LATENCY_BUCKETS = [10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, float("inf")]
+
+# The stamps below this value (2021-01-01 in ms) are milliseconds since boot, the clock was not synced yet
+EPOCH_SYNCED = 1609459200000
+
+
+class Latency:
+    """Collects latency samples (ms) into a histogram and keeps them for percentiles"""
+
+    def __init__(self):
+        self.samples = []
+
+    def add(self, value):
+        self.samples.append(value)
+
+    def report(self, name):
+        if not self.samples:
+            return f"{name}: no samples"
+        samples = sorted(self.samples)
+
+        def percentile(p):
+            return samples[min(len(samples) - 1, int(len(samples) * p / 100))]
+
+        lines = [f"{name}: {len(samples)} samples, p50 {percentile(50):.0f} ms, p90 {percentile(90):.0f} ms, "
+                 f"p99 {percentile(99):.0f} ms, max {samples[-1]:.0f} ms"]
+        lower = float("-inf")
+        for upper in LATENCY_BUCKETS:
+            count = sum(1 for s in samples if lower < s <= upper)
+            if count:
+                label = f"<= {upper:.0f}" if upper != float("inf") else f"> {lower:.0f}"
+                bar = "#" * max(1, round(count / len(samples) * 50))
+                lines.append(f"  {label:>8} ms {count:>7} {bar}")
+            lower = upper
+        return "\n".join(lines)
+
+
+def run_latency(args):
+    import paho.mqtt.client as mqtt
+
+    lock = threading.Lock()
+    # sensor-to-publish is measured on the device clock alone, sensor-to-host needs both clocks synced
+    device_side, end_to_end = Latency(), Latency()
+    counters = {"messages": 0, "received": 0, "late": 0, "lost": 0, "restarts": 0, "unsynced": 0}
+    # Per device: the last live sequence number, the gaps not delivered yet and the backlog
+    # deliveries ahead of the live messages
+    sequences = {}
+
+    def on_connect(client, *_):
+        client.subscribe(f"{args.prefix}/#")
+
+    def measure(acquired, published, arrived):
+        device_side.add(published - acquired)
+        if acquired >= EPOCH_SYNCED:
+            end_to_end.add(arrived - acquired)
+        else:
+            counters["unsynced"] += 1
+
+    def on_live(device, value, arrived):
+        counters["messages"] += 1
+        state = sequences.setdefault(device, {"last": None, "missing": set(), "early": set()})
+        sequence = value["seq"]
+        if state["last"] is not None and sequence <= state["last"]:
+            # The sequence starts over after reboot, the gaps of the previous boot are lost for good
+            counters["restarts"] += 1
+            counters["lost"] += len(state["missing"])
+            state["missing"].clear()
+            state["early"].clear()
+        elif state["last"] is not None:
+            for gap in range(state["last"] + 1, sequence):
+                if gap in state["early"]:
+                    state["early"].discard(gap)
+                else:
+                    state["missing"].add(gap)
+        counters["received"] += 1
+        state["last"] = sequence
+        measure(*value["time"], arrived)
+
+    def on_backlog(device, groups, arrived):
+        # The failed messages are delivered late as the backlog groups carrying their sequence numbers
+        counters["messages"] += 1
+        state = sequences.get(device)
+        for group in groups:
+            if not isinstance(group, dict) or "seq" not in group or "time" not in group:
+                continue
+            sequence = group["seq"]
+            if state is not None and sequence in state["missing"]:
+                state["missing"].discard(sequence)
+                counters["late"] += 1
+            elif state is not None and state["last"] is not None and sequence > state["last"]:
+                if sequence not in state["early"]:
+                    state["early"].add(sequence)
+                    counters["late"] += 1
+            measure(*group["time"], arrived)
+
+    def on_message(_, __, message):
+        arrived = time.time() * 1000
+        # The retained messages were published before the subscription
+        if message.retain:
+            return
+        try:
+            value = decode(message.payload)
+        except Exception:
+            return
+        # The namespaced topic carries the device ID: <prefix>/<device id>/<name>
+        parts = message.topic.split("/")
+        device = parts[1] if len(parts) > 2 else "-"
+        with lock:
+            if isinstance(value, list) and parts[-1] == "backlog":
+                on_backlog(device, value, arrived)
+            elif isinstance(value, dict) and "seq" in value and "time" in value:
+                on_live(device, value, arrived)
+
+    def report():
+        with lock:
+            lost = counters["lost"] + sum(len(state["missing"]) for state in sequences.values())
+            expected = counters["received"] + counters["late"] + lost
+            loss = lost / expected * 100 if expected else 0.
+            print(f"\n{len(sequences)} devices, {counters['messages']} messages, {counters['late']} delivered "
+                  f"late from backlog, {lost} lost ({loss:.2f} %), {counters['restarts']} restarts, "
+                  f"{counters['unsynced']} with unsynced clock")
+            print(device_side.report("sensor to publish"))
+            print(end_to_end.report("sensor to host"), flush=True)
+
+    client = connect(mqtt, args)
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.host, args.port)
+    client.loop_start()
+    start = time.monotonic()
+    try:
+        while True:
+            elapsed = time.monotonic() - start
+            if args.duration and elapsed >= args.duration:
+                break
+            time.sleep(min(args.interval, args.duration - elapsed) if args.duration else args.interval)
+            report()
+    except KeyboardInterrupt:
+        report()
+    finally:
+        client.loop_stop()
+
+
+# The raw reading trace format (keep in sync with lib/TraceFormat/src/TraceFormat.h)
+TRACE_MAGIC = b"ACT1"
+TRACE_SOURCES = {
+    1: ("bme680", ["rawTemperature", "rawHumidity", "pressure", "gasResistance", "temperature", "humidity",
+                   "iaq", "co2Eq", "breathVocEq", "gasPercentage", "stabStatus", "runInStatus"],
+        [100, 100, 1, 1, 100, 100, 100, 10, 1000, 10, 1, 1]),
+    2: ("ccs811", ["co2", "tvoc"], [1, 1]),
+}
+
+
+def read_varint(data, position):
+    value = shift = 0
+    while True:
+        byte = data[position]
+        position += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, position
+
+
+def decode_trace(data):
+    """Yields (time ms, source name, {field: value}) of the trace records"""
+    if not data.startswith(TRACE_MAGIC):
+        raise ValueError("not a trace")
+    position, time_ms, offset = len(TRACE_MAGIC), None, 0
+    last = {source: [0] * len(fields) for source, (_, fields, _) in TRACE_SOURCES.items()}
+    while position < len(data):
+        source = data[position]
+        delta, position = read_varint(data, position + 1)
+        if source == 0:
+            # The time since boot going back means reboot, the times keep growing across it
+            if time_ms is not None and delta + offset < time_ms:
+                offset = time_ms - delta
+            time_ms = delta + offset
+            last = {s: [0] * len(values) for s, values in last.items()}
+            continue
+        name, fields, scales = TRACE_SOURCES[source]
+        time_ms += delta
+        values = {}
+        for index, field in enumerate(fields):
+            value, position = read_varint(data, position)
+            last[source][index] += (value >> 1) ^ -(value & 1)
+            values[field] = last[source][index] / scales[index]
+        yield time_ms, name, values
+
+
+def read_capture(path):
+    """Reads the trace file or assembles it from serial capture lines (#T <hex>) starting at a sync record"""
+    with open(path, "rb") as source:
+        data = source.read()
+    if data.startswith(TRACE_MAGIC):
+        return data
+    chunks = []
+    for line in data.decode(errors="replace").splitlines():
+        if not line.startswith("#T "):
+            continue
+        try:
+            chunk = bytes.fromhex(line[3:].strip())
+        except ValueError:
+            # The line broken by the capture start or a reset, the next sync record resumes decoding
+            chunks.append(None)
+            continue
+        chunks.append(chunk)
+    data = bytearray(TRACE_MAGIC)
+    synced = False
+    for chunk in chunks:
+        if chunk is None:
+            synced = False
+        elif synced or chunk[0] == 0:
+            synced = True
+            data += chunk
+    return bytes(data)
+
+
+def run_trace(args):
+    data = read_capture(args.input)
+    if args.output:
+        with open(args.output, "wb") as output:
+            output.write(data)
+    counts, first, last = {}, None, None
+    for time_ms, source, values in decode_trace(data):
+        counts[source] = counts.get(source, 0) + 1
+        first = time_ms if first is None else first
+        last = time_ms
+        if args.samples:
+            print(time_ms, source, " ".join(f"{k}={v:g}" for k, v in values.items()))
+    records = sum(counts.values())
+    if records == 0:
+        print("No samples")
+        return
+    print(f"{records} samples ({', '.join(f'{v} {k}' for k, v in counts.items())}) over "
+          f"{(last - first) / 3600000:.2f} h, {len(data)} bytes ({len(data) / records:.1f} per sample)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    command = commands.add_parser("decode", help="print decoded payloads")
+    command.add_argument("--host", default="localhost")
+    command.add_argument("--port", type=int, default=1883)
+    command.add_argument("--user")
+    command.add_argument("--password")
+    command.add_argument("--prefix", default="airocat")
+    command.set_defaults(run=run_decode)
+
+    command = commands.add_parser("compare", help="compare payload sizes of encodings")
+    command.set_defaults(run=run_compare)
+
+    command = commands.add_parser("fleet", help="simulate many devices against a broker")
+    command.add_argument("--program", default=".pio/build/native/program", help="native build of firmware")
+    command.add_argument("--devices", type=int, default=100)
+    command.add_argument("--duration", type=float, default=300, help="seconds to run")
+    command.add_argument("--interval", type=float, default=10, help="seconds between reports")
+    command.add_argument("--ramp", type=float, default=10, help="seconds to spread the device starts over")
+    command.add_argument("--chip-base", type=int, default=0x100000, help="chip ID of the first device")
+    command.add_argument("--broker-pid", type=int, help="broker process to report CPU usage of")
+    command.add_argument("--host", default="localhost")
+    command.add_argument("--port", type=int, default=1883)
+    command.add_argument("--user")
+    command.add_argument("--password")
+    command.add_argument("--prefix", default="airocat")
+    command.set_defaults(run=run_fleet)
+
+    command = commands.add_parser("latency", help="report latency and loss of stamped messages")
+    command.add_argument("--duration", type=float, default=0, help="seconds to run (0 - till interrupted)")
+    command.add_argument("--interval", type=float, default=60, help="seconds between reports")
+    command.add_argument("--host", default="localhost")
+    command.add_argument("--port", type=int, default=1883)
+    command.add_argument("--user")
+    command.add_argument("--password")
+    command.add_argument("--prefix", default="airocat")
+    command.set_defaults(run=run_latency)
+
+    command = commands.add_parser("trace", help="convert serial capture into trace and print its summary")
+    command.add_argument("input", help="trace file or serial capture with #T lines")
+    command.add_argument("--output", help="trace file to write (for the replay of native build)")
+    command.add_argument("--samples", action="store_true", help="print decoded samples")
+    command.set_defaults(run=run_trace)
+
+    args = parser.parse_args()
+    args.run(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())